@@ -3,10 +3,13 @@
 #include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
 
 struct _drmModeAtomicReq;
 
 #include "decls.h"
+#include "propkey.h"
 
 namespace kms
 {
@@ -21,9 +24,13 @@ public:
 
 	void add(uint32_t ob_id, uint32_t prop_id, uint64_t value);
 	void add(DrmPropObject* ob, Property* prop, uint64_t value);
+	void add(DrmPropObject* ob, PropKey prop, uint64_t value);
 	void add(DrmPropObject* ob, const std::string& prop, uint64_t value);
 	void add(DrmPropObject* ob, const std::map<std::string, uint64_t>& values);
 
+	// Create a blob from data, owned by the request, and set prop to its id
+	void add_blob(DrmPropObject* ob, const std::string& prop, const void* data, size_t len);
+
 	void add_display(Connector* conn, Crtc* crtc, Blob* videomode,
 			 Plane* primary, Framebuffer* fb);
 
@@ -34,6 +41,74 @@ public:
 private:
 	Card& m_card;
 	_drmModeAtomicReq* m_req;
+	std::vector<std::unique_ptr<Blob>> m_blobs;
+};
+
+/*
+ * An atomic request with a fixed set of (object, property) slots, for
+ * committing the same properties again and again, e.g. the FB_IDs of the
+ * planes when page flipping.
+ *
+ * The slots are laid out when added, grouped by object, in the arrays the
+ * atomic ioctl takes. Setting a slot only writes its value in place, and a
+ * commit passes the arrays straight to the ioctl.
+ *
+ * A slot can be made inactive, to leave it out of the commits, e.g. to only
+ * commit the planes that have a new fb. The active slots are then copied to
+ * separate arrays on commit.
+ */
+class PreparedAtomicReq
+{
+public:
+	PreparedAtomicReq(Card& card);
+
+	PreparedAtomicReq(const PreparedAtomicReq& other) = delete;
+	PreparedAtomicReq& operator=(const PreparedAtomicReq& other) = delete;
+
+	// Add a slot for the property, with the given initial value. Returns the
+	// index of the slot, for set().
+	size_t add(DrmPropObject* ob, Property* prop, uint64_t value = 0);
+	size_t add(DrmPropObject* ob, PropKey prop, uint64_t value = 0);
+	size_t add(DrmPropObject* ob, const std::string& prop, uint64_t value = 0);
+
+	size_t num_slots() const { return m_slot_pos.size(); }
+
+	// The slot indices are checked, and out of range ones throw out_of_range
+	void set(size_t slot, uint64_t value) { m_values[m_slot_pos.at(slot)] = value; }
+	uint64_t get(size_t slot) const { return m_values[m_slot_pos.at(slot)]; }
+
+	// Slots are active when added
+	void set_active(size_t slot, bool active);
+	bool is_active(size_t slot) const { return m_active[m_slot_pos.at(slot)]; }
+
+	int test(bool allow_modeset = false);
+	int commit(void* data, bool allow_modeset = false);
+	int commit_sync(bool allow_modeset = false);
+
+private:
+	int commit_flags(uint32_t flags, void* data);
+
+	Card& m_card;
+
+	// The ioctl arrays: the objects, the number of properties of each, and
+	// the properties and values of all the objects back to back
+	std::vector<uint32_t> m_objs;
+	std::vector<uint32_t> m_counts;
+	std::vector<uint32_t> m_props;
+	std::vector<uint64_t> m_values;
+
+	// The position of each slot in m_props and m_values
+	std::vector<size_t> m_slot_pos;
+
+	// Whether the property at each position is committed
+	std::vector<bool> m_active;
+	size_t m_num_inactive = 0;
+
+	// The ioctl arrays of the active slots, when some slots are inactive
+	std::vector<uint32_t> m_active_objs;
+	std::vector<uint32_t> m_active_counts;
+	std::vector<uint32_t> m_active_props;
+	std::vector<uint64_t> m_active_values;
 };
 
 } // namespace kms
@@ -23,6 +23,7 @@ struct CardVersion {
 class Card
 {
 	friend class Framebuffer;
+	friend class DrmPropObject;
 
 public:
 	static std::unique_ptr<Card> open_named_card(const std::string& name);
@@ -42,6 +43,10 @@ public:
 
 	Connector* get_first_connected_connector() const;
 
+	// Probe the connectors, or all the connectors if none are given, in
+	// parallel. See Connector::probe().
+	void probe_connectors(const std::vector<Connector*>& connectors = {});
+
 	DrmObject* get_object(uint32_t id) const;
 	Connector* get_connector(uint32_t id) const;
 	Crtc* get_crtc(uint32_t id) const;
@@ -55,13 +60,19 @@ public:
 	bool has_dumb_buffers() const { return m_has_dumb; }
 	bool has_kms() const;
 
-	std::vector<Connector*> get_connectors() const { return m_connectors; }
-	std::vector<Encoder*> get_encoders() const { return m_encoders; }
-	std::vector<Crtc*> get_crtcs() const { return m_crtcs; }
-	std::vector<Plane*> get_planes() const { return m_planes; }
-	std::vector<Property*> get_properties() const { return m_properties; }
+	// With lazy props (KMSXX_LAZY_PROPS), the metadata of the properties, e.g.
+	// their names, is not fetched when the card is set up, but on first use.
+	// The property values of the objects are always fetched.
+	bool lazy_props() const { return m_lazy_props; }
+
+	const std::vector<Connector*>& get_connectors() const { return m_connectors; }
+	const std::vector<Encoder*>& get_encoders() const { return m_encoders; }
+	const std::vector<Crtc*>& get_crtcs() const { return m_crtcs; }
+	const std::vector<Plane*>& get_planes() const { return m_planes; }
+	const std::vector<Property*>& get_properties() const { return m_properties; }
 
-	std::vector<DrmObject*> get_objects() const;
+	// All the objects, sorted by id
+	const std::vector<DrmObject*>& get_objects() const { return m_objects; }
 
 	std::vector<Pipeline> get_connected_pipelines();
 
@@ -73,10 +84,34 @@ public:
 	const CardVersion& version() const { return m_version; }
 
 private:
+	enum class ObjectKind : uint8_t {
+		None,
+		Connector,
+		Crtc,
+		Encoder,
+		Plane,
+		Property,
+	};
+
+	// A slot of the object id hash, locating the object in its typed table
+	struct ObjectSlot {
+		uint32_t id;
+		ObjectKind kind;
+		uint32_t idx;
+	};
+
 	void setup();
 	void restore_modes();
 
-	std::map<uint32_t, DrmObject*> m_obmap;
+	void add_object(DrmObject* ob, ObjectKind kind, uint32_t idx);
+	const ObjectSlot* find_object(uint32_t id) const;
+
+	// Add the property, if not added yet
+	void add_prop(uint32_t prop_id);
+
+	// Open addressing hash of the object ids, a power of two in size
+	std::vector<ObjectSlot> m_object_slots;
+	std::vector<DrmObject*> m_objects;
 
 	std::vector<Connector*> m_connectors;
 	std::vector<Encoder*> m_encoders;
@@ -92,6 +127,7 @@ private:
 	bool m_has_atomic;
 	bool m_has_universal_planes;
 	bool m_has_dumb;
+	bool m_lazy_props;
 
 	CardVersion m_version;
 };
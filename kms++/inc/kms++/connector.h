@@ -5,6 +5,8 @@
 #include "drmpropobject.h"
 #include "videomode.h"
 
+struct _drmModeConnector;
+
 namespace kms
 {
 struct ConnectorPriv;
@@ -20,6 +22,11 @@ class Connector : public DrmPropObject
 	friend class Card;
 
 public:
+	// Probe the connector, detecting it again and reading its EDID, which can
+	// take long. Card::probe_connectors() probes many in parallel.
+	void probe();
+
+	// Same as probe()
 	void refresh();
 
 	Videomode get_default_mode() const;
@@ -51,6 +58,9 @@ private:
 	void setup() override;
 	void restore_mode();
 
+	// Take the connector from drmModeGetConnector*()
+	void update(_drmModeConnector* drm_connector);
+
 	ConnectorPriv* m_priv;
 
 	std::string m_fullname;
@@ -16,6 +16,7 @@ class DmabufFramebuffer;
 class Framebuffer;
 class PageFlipHandlerBase;
 class Plane;
+class PropKey;
 class Property;
 struct Videomode;
 } // namespace kms
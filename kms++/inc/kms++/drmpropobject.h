@@ -1,10 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "drmobject.h"
 #include "decls.h"
+#include "propkey.h"
 
 namespace kms
 {
@@ -16,18 +20,22 @@ public:
 	void refresh_props();
 
 	bool has_prop(const std::string& name) const { return !!get_prop(name); }
+	bool has_prop(PropKey key) const { return !!get_prop(key); }
 
 	Property* get_prop(const std::string& name) const;
+	Property* get_prop(PropKey key) const;
 
 	uint64_t get_prop_value(uint32_t id) const;
 	uint64_t get_prop_value(const std::string& name) const;
+	uint64_t get_prop_value(PropKey key) const;
 	std::unique_ptr<Blob> get_prop_value_as_blob(const std::string& name) const;
 
-	const std::map<uint32_t, uint64_t>& get_prop_map() const { return m_prop_values; }
+	const std::map<uint32_t, uint64_t>& get_prop_map() const;
 
 	int set_prop_value(Property* prop, uint64_t value);
 	int set_prop_value(uint32_t id, uint64_t value);
 	int set_prop_value(const std::string& name, uint64_t value);
+	int set_prop_value(PropKey key, uint64_t value);
 
 protected:
 	DrmPropObject(Card& card, uint32_t object_type);
@@ -36,6 +44,15 @@ protected:
 	~DrmPropObject() override;
 
 private:
+	void fetch_props();
+	const std::vector<Property*>& key_props() const;
+
 	std::map<uint32_t, uint64_t> m_prop_values;
+
+	// The properties by PropKey index. Built when the properties are fetched,
+	// or with lazy props on the first lookup, as it needs the property names.
+	mutable std::vector<Property*> m_key_props;
+	mutable std::atomic<bool> m_key_index_built = false;
+	mutable std::mutex m_key_index_mutex;
 };
 } // namespace kms
@@ -13,6 +13,14 @@ enum class CpuAccess {
 	ReadWrite,
 };
 
+// Caching of the CPU mapping of a framebuffer. Write-combined (or uncached)
+// mappings are very slow to read, and fast to write only with large sequential
+// stores.
+enum class CpuCaching {
+	Cached,
+	WriteCombined,
+};
+
 class IFramebuffer
 {
 public:
@@ -32,6 +40,8 @@ public:
 
 	virtual void begin_cpu_access(CpuAccess access) {}
 	virtual void end_cpu_access() {}
+
+	virtual CpuCaching cpu_caching() const { return CpuCaching::Cached; }
 };
 
 class Framebuffer : public DrmObject, public IFramebuffer
@@ -48,6 +58,11 @@ public:
 	void flush(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 	void flush();
 
+	CpuCaching cpu_caching() const override { return m_cpu_caching; }
+	// Override the caching detected for the mapping, e.g. for a dmabuf whose
+	// exporter maps it write-combined
+	void set_cpu_caching(CpuCaching caching) { m_cpu_caching = caching; }
+
 protected:
 	Framebuffer(Card& card, uint32_t width, uint32_t height);
 
@@ -56,6 +71,7 @@ private:
 	uint32_t m_height;
 	uint32_t m_fourcc;
 	PixelFormat m_format;
+	CpuCaching m_cpu_caching = CpuCaching::Cached;
 };
 
 } // namespace kms
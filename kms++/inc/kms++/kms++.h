@@ -11,6 +11,7 @@
 #include "dmabufframebuffer.h"
 #include "plane.h"
 #include "property.h"
+#include "propkey.h"
 #include "blob.h"
 #include "pipeline.h"
 #include "pagefliphandler.h"
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 #include <tuple>
-#include <vector>
 
 namespace kms
 {
@@ -147,17 +150,43 @@ struct PixelFormatPlaneInfo {
 	{
 	}
 
-	uint8_t bytes_per_block;
-	uint8_t pixels_per_block;
-	uint8_t hsub;
-	uint8_t vsub;
+	uint8_t bytes_per_block = 0;
+	uint8_t pixels_per_block = 0;
+	uint8_t hsub = 0;
+	uint8_t vsub = 0;
+};
+
+// The plane infos of a format, stored inline so that the infos are constexpr
+class PixelFormatPlaneInfos
+{
+public:
+	static constexpr size_t max_planes = 4;
+
+	constexpr PixelFormatPlaneInfos() = default;
+
+	constexpr PixelFormatPlaneInfos(std::initializer_list<PixelFormatPlaneInfo> planes)
+		: m_size(planes.size())
+	{
+		std::copy(planes.begin(), planes.end(), m_planes.begin());
+	}
+
+	constexpr size_t size() const { return m_size; }
+	constexpr bool empty() const { return m_size == 0; }
+
+	constexpr const PixelFormatPlaneInfo& operator[](size_t idx) const { return m_planes[idx]; }
+
+	constexpr const PixelFormatPlaneInfo* begin() const { return m_planes.data(); }
+	constexpr const PixelFormatPlaneInfo* end() const { return m_planes.data() + m_size; }
+
+private:
+	std::array<PixelFormatPlaneInfo, max_planes> m_planes{};
+	size_t m_size = 0;
 };
 
 struct PixelFormatInfo {
-	#if HAS_CONSTEXPR_STR && HAS_CONSTEXPR_VEC
-	constexpr
-	#endif
-	PixelFormatInfo(const std::string_view name,
+	constexpr PixelFormatInfo() = default;
+
+	constexpr PixelFormatInfo(const std::string_view name,
 	                          const std::string_view drm_fourcc,
 	                          const std::string_view v4l2_4cc,
 				  PixelColorType color,
@@ -169,15 +198,15 @@ struct PixelFormatInfo {
 	{
 	}
 
-	std::string name;
-	uint32_t drm_fourcc;
-	uint32_t v4l2_4cc;
+	std::string_view name;
+	uint32_t drm_fourcc = 0;
+	uint32_t v4l2_4cc = 0;
 
-	PixelColorType type;
+	PixelColorType type = PixelColorType::Undefined;
 	std::tuple<uint8_t, uint8_t> pixel_align;
 
-	uint8_t num_planes; // this should be dropped, and use 'planes' vector size
-	std::vector<PixelFormatPlaneInfo> planes;
+	uint8_t num_planes = 0; // this should be dropped, and use 'planes' size
+	PixelFormatPlaneInfos planes;
 
 	std::tuple<uint32_t, uint32_t> align_pixels(uint32_t width, uint32_t height) const;
 	uint32_t stride(uint32_t width, uint32_t plane = 0, uint32_t align = 1) const;
@@ -0,0 +1,1125 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+#include <kms++/pixelformats.h>
+
+namespace kms
+{
+/*
+ * The pixel format infos as a constexpr table, indexed by PixelFormat, and
+ * hash indices for finding the formats by fourcc and by name. Everything is
+ * built at compile time, so there's no static initialization, and the infos
+ * can be used in constant expressions.
+ */
+
+// PixelFormat::MJPEG is the last format
+constexpr size_t num_pixel_formats = (size_t)PixelFormat::MJPEG + 1;
+
+namespace detail
+{
+struct PixelFormatEntry {
+	PixelFormat format;
+	PixelFormatInfo info;
+};
+
+consteval std::array<PixelFormatInfo, num_pixel_formats>
+make_pixel_format_table(std::initializer_list<PixelFormatEntry> entries)
+{
+	std::array<PixelFormatInfo, num_pixel_formats> table{};
+
+	for (const PixelFormatEntry& e : entries) {
+		const size_t idx = (size_t)e.format;
+
+		// Not a constant expression if out of range or duplicate
+		if (idx == 0 || idx >= num_pixel_formats || table[idx].num_planes != 0)
+			throw "Bad pixel format entry";
+
+		table[idx] = e.info;
+	}
+
+	return table;
+}
+} // namespace detail
+
+inline constexpr std::array<PixelFormatInfo, num_pixel_formats> pixel_format_infos =
+	detail::make_pixel_format_table({
+	{
+		PixelFormat::R8, {
+			PixelFormatInfo {
+				"R8",
+				"R8  ",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGB332, {
+			PixelFormatInfo {
+				"RGB332",
+				"RGB8",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGB565, {
+			PixelFormatInfo {
+				"RGB565",
+				"RG16",
+				"RGBP",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::BGR565, {
+			PixelFormatInfo {
+				"BGR565",
+				"BG16",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XRGB1555, {
+			PixelFormatInfo {
+				"XRGB1555",
+				"XR15",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGBX4444, {
+			PixelFormatInfo {
+				"RGBX4444",
+				"RX12",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XRGB4444, {
+			PixelFormatInfo {
+				"XRGB4444",
+				"XR12",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::ARGB1555, {
+			PixelFormatInfo {
+				"ARGB1555",
+				"AR15",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGBA4444, {
+			PixelFormatInfo {
+				"RGBA4444",
+				"RA12",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::ARGB4444, {
+			PixelFormatInfo {
+				"ARGB4444",
+				"AR12",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGB888, {
+			PixelFormatInfo {
+				"RGB888",
+				"RG24",
+				"BGR3",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 3, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::BGR888, {
+			PixelFormatInfo {
+				"BGR888",
+				"BG24",
+				"RGB3",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 3, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XRGB8888, {
+			PixelFormatInfo {
+				"XRGB8888",
+				"XR24",
+				"XR24",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XBGR8888, {
+			PixelFormatInfo {
+				"XBGR8888",
+				"XB24",
+				"XB24",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGBX8888, {
+			PixelFormatInfo {
+				"RGBX8888",
+				"RX24",
+				"RX24",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::BGRX8888, {
+			PixelFormatInfo {
+				"BGRX8888",
+				"BX24",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XBGR2101010, {
+			PixelFormatInfo {
+				"XBGR2101010",
+				"XB30",
+				"RX30",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XRGB2101010, {
+			PixelFormatInfo {
+				"XRGB2101010",
+				"XR30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGBX1010102, {
+			PixelFormatInfo {
+				"RGBX1010102",
+				"RX30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::BGRX1010102, {
+			PixelFormatInfo {
+				"BGRX1010102",
+				"BX30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::ARGB8888, {
+			PixelFormatInfo {
+				"ARGB8888",
+				"AR24",
+				"AR24",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::ABGR8888, {
+			PixelFormatInfo {
+				"ABGR8888",
+				"AB24",
+				"AB24",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGBA8888, {
+			PixelFormatInfo {
+				"RGBA8888",
+				"RA24",
+				"RA24",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::BGRA8888, {
+			PixelFormatInfo {
+				"BGRA8888",
+				"BA24",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::ABGR2101010, {
+			PixelFormatInfo {
+				"ABGR2101010",
+				"AB30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::ARGB2101010, {
+			PixelFormatInfo {
+				"ARGB2101010",
+				"AR30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::RGBA1010102, {
+			PixelFormatInfo {
+				"RGBA1010102",
+				"RA30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::BGRA1010102, {
+			PixelFormatInfo {
+				"BGRA1010102",
+				"BA30",
+				"",
+				PixelColorType::RGB,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YUYV, {
+			PixelFormatInfo {
+				"YUYV",
+				"YUYV",
+				"YUYV",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::UYVY, {
+			PixelFormatInfo {
+				"UYVY",
+				"UYVY",
+				"UYVY",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YVYU, {
+			PixelFormatInfo {
+				"YVYU",
+				"YVYU",
+				"YVYU",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::VYUY, {
+			PixelFormatInfo {
+				"VYUY",
+				"VYUY",
+				"VYUY",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::VUY888, {
+			PixelFormatInfo {
+				"VUY888",
+				"VU24",
+				"YUV3",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 3, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XVUY8888, {
+			PixelFormatInfo {
+				"XVUY8888",
+				"XVUY",
+				"YUVX",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y210, {
+			PixelFormatInfo {
+				"Y210",
+				"Y210",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 8, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y212, {
+			PixelFormatInfo {
+				"Y212",
+				"Y212",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 8, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y216, {
+			PixelFormatInfo {
+				"Y216",
+				"Y216",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 8, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::NV12, {
+			PixelFormatInfo {
+				"NV12",
+				"NV12",
+				"NM12",
+				PixelColorType::YUV,
+				{ 2, 2 },
+				{ { 1, 1, 1, 1 }, { 2, 1, 2, 2 } },
+			}
+		}
+	},
+	{
+		PixelFormat::NV21, {
+			PixelFormatInfo {
+				"NV21",
+				"NV21",
+				"NM21",
+				PixelColorType::YUV,
+				{ 2, 2 },
+				{ { 1, 1, 1, 1 }, { 2, 1, 2, 2 } },
+			}
+		}
+	},
+	{
+		PixelFormat::NV16, {
+			PixelFormatInfo {
+				"NV16",
+				"NV16",
+				"NM16",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 1, 1, 1, 1 }, { 2, 1, 2, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::NV61, {
+			PixelFormatInfo {
+				"NV61",
+				"NV61",
+				"NM61",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 1, 1, 1, 1 }, { 2, 1, 2, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XV15, {
+			PixelFormatInfo {
+				"XV15",
+				"XV15",
+				"",
+				PixelColorType::YUV,
+				{ 6, 2 },
+				{ { 4, 3, 1, 1 }, { 8, 3, 2, 2 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XV20, {
+			PixelFormatInfo {
+				"XV20",
+				"XV20",
+				"",
+				PixelColorType::YUV,
+				{ 6, 2 },
+				{ { 4, 3, 1, 1 }, { 8, 3, 2, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::XVUY2101010, {
+			PixelFormatInfo {
+				"XVUY2101010",
+				"XY30",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YUV420, {
+			PixelFormatInfo {
+				"YUV420",
+				"YU12",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 }, { 1, 1, 2, 2 }, { 1, 1, 2, 2 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YVU420, {
+			PixelFormatInfo {
+				"YVU420",
+				"YV12",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 }, { 1, 1, 2, 2 }, { 1, 1, 2, 2 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YUV422, {
+			PixelFormatInfo {
+				"YUV422",
+				"YU16",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 }, { 1, 1, 2, 1 }, { 1, 1, 2, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YVU422, {
+			PixelFormatInfo {
+				"YVU422",
+				"YV16",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 }, { 1, 1, 2, 1 }, { 1, 1, 2, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YUV444, {
+			PixelFormatInfo {
+				"YUV444",
+				"YU24",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::YVU444, {
+			PixelFormatInfo {
+				"YVU444",
+				"YV24",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 }, { 1, 1, 1, 1 }, { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::X403, {
+			PixelFormatInfo {
+				"X403",
+				"X403",
+				"",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 4, 1, 1, 1 }, { 4, 1, 1, 1 }, { 4, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y8, {
+			PixelFormatInfo {
+				"Y8",
+				"GREY",
+				"GREY",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y10, {
+			PixelFormatInfo {
+				"Y10",
+				"",
+				"Y10 ",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y10P, {
+			PixelFormatInfo {
+				"Y10P",
+				"",
+				"Y10P",
+				PixelColorType::YUV,
+				{ 4, 1 },
+				{ { 5, 4, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y12, {
+			PixelFormatInfo {
+				"Y12",
+				"",
+				"Y12 ",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 2, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y12P, {
+			PixelFormatInfo {
+				"Y12P",
+				"",
+				"Y12P",
+				PixelColorType::YUV,
+				{ 2, 1 },
+				{ { 3, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::Y10_P32, {
+			PixelFormatInfo {
+				"Y10_P32",
+				"YPA4",
+				"",
+				PixelColorType::YUV,
+				{ 3, 1 },
+				{ { 4, 3, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SBGGR8, {
+			PixelFormatInfo {
+				"SBGGR8",
+				"",
+				"BA81",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGBRG8, {
+			PixelFormatInfo {
+				"SGBRG8",
+				"",
+				"GBRG",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGRBG8, {
+			PixelFormatInfo {
+				"SGRBG8",
+				"",
+				"GRBG",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SRGGB8, {
+			PixelFormatInfo {
+				"SRGGB8",
+				"",
+				"RGGB",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SBGGR10, {
+			PixelFormatInfo {
+				"SBGGR10",
+				"",
+				"BG10",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGBRG10, {
+			PixelFormatInfo {
+				"SGBRG10",
+				"",
+				"GB10",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGRBG10, {
+			PixelFormatInfo {
+				"SGRBG10",
+				"",
+				"BA10",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SRGGB10, {
+			PixelFormatInfo {
+				"SRGGB10",
+				"",
+				"RG10",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SBGGR10P, {
+			PixelFormatInfo {
+				"SBGGR10P",
+				"",
+				"pBAA",
+				PixelColorType::RAW,
+				{ 4, 2 },
+				{ { 5, 4, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGBRG10P, {
+			PixelFormatInfo {
+				"SGBRG10P",
+				"",
+				"pGAA",
+				PixelColorType::RAW,
+				{ 4, 2 },
+				{ { 5, 4, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGRBG10P, {
+			PixelFormatInfo {
+				"SGRBG10P",
+				"",
+				"pgAA",
+				PixelColorType::RAW,
+				{ 4, 2 },
+				{ { 5, 4, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SRGGB10P, {
+			PixelFormatInfo {
+				"SRGGB10P",
+				"",
+				"pRAA",
+				PixelColorType::RAW,
+				{ 4, 2 },
+				{ { 5, 4, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SBGGR12, {
+			PixelFormatInfo {
+				"SBGGR12",
+				"",
+				"BG12",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGBRG12, {
+			PixelFormatInfo {
+				"SGBRG12",
+				"",
+				"GB12",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGRBG12, {
+			PixelFormatInfo {
+				"SGRBG12",
+				"",
+				"BA12",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SRGGB12, {
+			PixelFormatInfo {
+				"SRGGB12",
+				"",
+				"RG12",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SBGGR12P, {
+			PixelFormatInfo {
+				"SBGGR12P",
+				"",
+				"pBCC",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 3, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGBRG12P, {
+			PixelFormatInfo {
+				"SGBRG12P",
+				"",
+				"pGCC",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 3, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGRBG12P, {
+			PixelFormatInfo {
+				"SGRBG12P",
+				"",
+				"pgCC",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 3, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SRGGB12P, {
+			PixelFormatInfo {
+				"SRGGB12P",
+				"",
+				"pRCC",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 3, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SBGGR16, {
+			PixelFormatInfo {
+				"SBGGR16",
+				"",
+				"BYR2",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGBRG16, {
+			PixelFormatInfo {
+				"SGBRG16",
+				"",
+				"GB16",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SGRBG16, {
+			PixelFormatInfo {
+				"SGRBG16",
+				"",
+				"GR16",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::SRGGB16, {
+			PixelFormatInfo {
+				"SRGGB16",
+				"",
+				"RG16",
+				PixelColorType::RAW,
+				{ 2, 2 },
+				{ { 4, 2, 1, 1 } },
+			}
+		}
+	},
+	{
+		PixelFormat::MJPEG, {
+			PixelFormatInfo {
+				"MJPEG",
+				"MJPG",
+				"MJPG",
+				PixelColorType::YUV,
+				{ 1, 1 },
+				{ { 1, 1, 1, 1 } },
+			}
+		}
+	},
+	});
+
+// The info of the format, with num_planes 0 for PixelFormat::Undefined
+constexpr const PixelFormatInfo& pixel_format_info(PixelFormat format)
+{
+	return pixel_format_infos[(size_t)format];
+}
+
+namespace detail
+{
+constexpr uint32_t hash_fourcc(uint32_t fourcc)
+{
+	return fourcc * 0x9e3779b1u;
+}
+
+// FNV-1a
+constexpr uint32_t hash_name(std::string_view name)
+{
+	uint32_t h = 0x811c9dc5u;
+
+	for (char c : name)
+		h = (h ^ (uint8_t)c) * 0x01000193u;
+
+	return h;
+}
+
+/*
+ * An open addressing hash table of the formats, with linear probing. The
+ * size is a power of two, at least four times the number of formats, so the
+ * probe sequences stay short. Empty slots are PixelFormat::Undefined.
+ */
+struct PixelFormatIndex {
+	static constexpr size_t size = 512;
+	static constexpr size_t mask = size - 1;
+
+	std::array<PixelFormat, size> slots{};
+
+	// Insert the first format for each key, in PixelFormat order, like a
+	// linear search would find them
+	template<typename Hash, typename Key>
+	constexpr PixelFormatIndex(Hash hash, Key key)
+	{
+		for (size_t i = 1; i < num_pixel_formats; i++) {
+			const PixelFormat format = (PixelFormat)i;
+			size_t slot = hash(key(pixel_format_infos[i])) & mask;
+
+			for (; slots[slot] != PixelFormat::Undefined; slot = (slot + 1) & mask) {
+				if (key(pixel_format_infos[(size_t)slots[slot]]) ==
+				    key(pixel_format_infos[i]))
+					break;
+			}
+
+			if (slots[slot] == PixelFormat::Undefined)
+				slots[slot] = format;
+		}
+	}
+
+	template<typename Hash, typename Key, typename T>
+	constexpr PixelFormat find(Hash hash, Key key, const T& value) const
+	{
+		for (size_t slot = hash(value) & mask; slots[slot] != PixelFormat::Undefined;
+		     slot = (slot + 1) & mask) {
+			if (key(pixel_format_infos[(size_t)slots[slot]]) == value)
+				return slots[slot];
+		}
+
+		return PixelFormat::Undefined;
+	}
+};
+
+constexpr auto fourcc_key = [](const PixelFormatInfo& info) { return info.drm_fourcc; };
+constexpr auto name_key = [](const PixelFormatInfo& info) { return info.name; };
+
+inline constexpr PixelFormatIndex pixel_format_fourcc_index(hash_fourcc, fourcc_key);
+inline constexpr PixelFormatIndex pixel_format_name_index(hash_name, name_key);
+} // namespace detail
+
+// PixelFormat::Undefined if not found
+constexpr PixelFormat pixel_format_by_fourcc(uint32_t fourcc)
+{
+	return detail::pixel_format_fourcc_index.find(detail::hash_fourcc, detail::fourcc_key,
+						      fourcc);
+}
+
+// PixelFormat::Undefined if not found
+constexpr PixelFormat pixel_format_by_name(std::string_view name)
+{
+	return detail::pixel_format_name_index.find(detail::hash_name, detail::name_key, name);
+}
+
+} // namespace kms
@@ -28,7 +28,7 @@ public:
 	bool is_immutable() const;
 	bool is_pending() const;
 
-	PropertyType type() const { return m_type; }
+	PropertyType type() const;
 	std::map<uint64_t, std::string> get_enums() const;
 	std::vector<uint64_t> get_values() const;
 	std::vector<uint32_t> get_blob_ids() const;
@@ -37,9 +37,10 @@ private:
 	Property(Card& card, uint32_t id);
 	~Property() override;
 
-	PropertyType m_type;
+	// The metadata, fetched on first use with lazy props
+	const PropertyPriv& info() const;
+	void fetch_info() const;
 
 	PropertyPriv* m_priv;
-	std::string m_name;
 };
 } // namespace kms
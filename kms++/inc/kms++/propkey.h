@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace kms
+{
+/*
+ * A property name interned to a small process wide index. Objects index their
+ * properties by the keys, so a property can be looked up without going through
+ * all the properties of the object and comparing their names.
+ *
+ * Keys are cheap to copy, but interning a name takes a lock, so the keys used
+ * in hot paths should be created once, e.g. as static locals. Names that come
+ * from the user should be looked up with find(), which does not intern them.
+ */
+class PropKey
+{
+public:
+	explicit PropKey(std::string_view name);
+
+	// The key of the name, if the name has been interned
+	static std::optional<PropKey> find(std::string_view name);
+
+	uint32_t index() const { return m_index; }
+	const std::string& name() const;
+
+	bool operator==(const PropKey& other) const { return m_index == other.m_index; }
+
+	// The number of names interned so far
+	static uint32_t count();
+
+private:
+	PropKey(uint32_t index) : m_index(index) {}
+
+	uint32_t m_index;
+};
+} // namespace kms
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
 #include <stdexcept>
 
 #include <xf86drm.h>
@@ -60,6 +62,16 @@ void AtomicReq::add(DrmPropObject* ob, Property* prop, uint64_t value)
 	add(ob->id(), prop->id(), value);
 }
 
+void AtomicReq::add(DrmPropObject* ob, PropKey prop, uint64_t value)
+{
+	Property* p = ob->get_prop(prop);
+
+	if (!p)
+		throw runtime_error("Property not found");
+
+	add(ob, p, value);
+}
+
 void AtomicReq::add(kms::DrmPropObject* ob, const string& prop, uint64_t value)
 {
 	Property* p = ob->get_prop(prop);
@@ -76,29 +88,45 @@ void AtomicReq::add(kms::DrmPropObject* ob, const map<string, uint64_t>& values)
 		add(ob, kvp.first, kvp.second);
 }
 
+void AtomicReq::add_blob(DrmPropObject* ob, const string& prop, const void* data, size_t len)
+{
+	auto blob = make_unique<Blob>(m_card, const_cast<void*>(data), len);
+
+	add(ob, prop, blob->id());
+
+	m_blobs.push_back(std::move(blob));
+}
+
 void AtomicReq::add_display(Connector* conn, Crtc* crtc, Blob* videomode, Plane* primary, Framebuffer* fb)
 {
-	add(conn, {
-			  { "CRTC_ID", crtc->id() },
-		  });
-
-	add(crtc, {
-			  { "ACTIVE", 1 },
-			  { "MODE_ID", videomode->id() },
-		  });
-
-	add(primary, {
-			     { "FB_ID", fb->id() },
-			     { "CRTC_ID", crtc->id() },
-			     { "SRC_X", 0 << 16 },
-			     { "SRC_Y", 0 << 16 },
-			     { "SRC_W", fb->width() << 16 },
-			     { "SRC_H", fb->height() << 16 },
-			     { "CRTC_X", 0 },
-			     { "CRTC_Y", 0 },
-			     { "CRTC_W", fb->width() },
-			     { "CRTC_H", fb->height() },
-		     });
+	static const PropKey crtc_id("CRTC_ID");
+	static const PropKey active("ACTIVE");
+	static const PropKey mode_id("MODE_ID");
+	static const PropKey fb_id("FB_ID");
+	static const PropKey src_x("SRC_X");
+	static const PropKey src_y("SRC_Y");
+	static const PropKey src_w("SRC_W");
+	static const PropKey src_h("SRC_H");
+	static const PropKey crtc_x("CRTC_X");
+	static const PropKey crtc_y("CRTC_Y");
+	static const PropKey crtc_w("CRTC_W");
+	static const PropKey crtc_h("CRTC_H");
+
+	add(conn, crtc_id, crtc->id());
+
+	add(crtc, active, 1);
+	add(crtc, mode_id, videomode->id());
+
+	add(primary, fb_id, fb->id());
+	add(primary, crtc_id, crtc->id());
+	add(primary, src_x, 0 << 16);
+	add(primary, src_y, 0 << 16);
+	add(primary, src_w, fb->width() << 16);
+	add(primary, src_h, fb->height() << 16);
+	add(primary, crtc_x, 0);
+	add(primary, crtc_y, 0);
+	add(primary, crtc_w, fb->width());
+	add(primary, crtc_h, fb->height());
 }
 
 int AtomicReq::test(bool allow_modeset)
@@ -130,4 +158,176 @@ int AtomicReq::commit_sync(bool allow_modeset)
 
 	return drmModeAtomicCommit(m_card.fd(), m_req, flags, 0);
 }
+
+PreparedAtomicReq::PreparedAtomicReq(Card& card)
+	: m_card(card)
+{
+	assert(card.has_atomic());
+}
+
+size_t PreparedAtomicReq::add(DrmPropObject* ob, Property* prop, uint64_t value)
+{
+	// The end of the object's properties, or of all of them for a new object
+	size_t obj_idx = 0;
+	size_t pos = 0;
+
+	for (; obj_idx < m_objs.size(); ++obj_idx) {
+		pos += m_counts[obj_idx];
+
+		if (m_objs[obj_idx] == ob->id())
+			break;
+	}
+
+	if (obj_idx == m_objs.size()) {
+		m_objs.push_back(ob->id());
+		m_counts.push_back(0);
+	} else {
+		auto first = m_props.begin() + (pos - m_counts[obj_idx]);
+		auto last = m_props.begin() + pos;
+
+		if (find(first, last, prop->id()) != last)
+			throw invalid_argument("Property already in the request");
+	}
+
+	m_counts[obj_idx]++;
+
+	m_props.insert(m_props.begin() + pos, prop->id());
+	m_values.insert(m_values.begin() + pos, value);
+	m_active.insert(m_active.begin() + pos, true);
+
+	for (size_t& slot_pos : m_slot_pos) {
+		if (slot_pos >= pos)
+			slot_pos++;
+	}
+
+	m_slot_pos.push_back(pos);
+
+	return m_slot_pos.size() - 1;
+}
+
+size_t PreparedAtomicReq::add(DrmPropObject* ob, PropKey prop, uint64_t value)
+{
+	Property* p = ob->get_prop(prop);
+
+	if (!p)
+		throw runtime_error("Property not found");
+
+	return add(ob, p, value);
+}
+
+size_t PreparedAtomicReq::add(DrmPropObject* ob, const string& prop, uint64_t value)
+{
+	Property* p = ob->get_prop(prop);
+
+	if (!p)
+		throw runtime_error("Property not found");
+
+	return add(ob, p, value);
+}
+
+void PreparedAtomicReq::set_active(size_t slot, bool active)
+{
+	size_t pos = m_slot_pos.at(slot);
+
+	if (m_active[pos] == active)
+		return;
+
+	m_active[pos] = active;
+
+	if (active)
+		m_num_inactive--;
+	else
+		m_num_inactive++;
+}
+
+int PreparedAtomicReq::commit_flags(uint32_t flags, void* data)
+{
+	const vector<uint32_t>* objs = &m_objs;
+	const vector<uint32_t>* counts = &m_counts;
+	const vector<uint32_t>* props = &m_props;
+	const vector<uint64_t>* values = &m_values;
+
+	if (m_num_inactive > 0) {
+		m_active_objs.clear();
+		m_active_counts.clear();
+		m_active_props.clear();
+		m_active_values.clear();
+
+		size_t pos = 0;
+
+		for (size_t obj_idx = 0; obj_idx < m_objs.size(); ++obj_idx) {
+			uint32_t count = 0;
+
+			for (size_t end = pos + m_counts[obj_idx]; pos < end; ++pos) {
+				if (!m_active[pos])
+					continue;
+
+				m_active_props.push_back(m_props[pos]);
+				m_active_values.push_back(m_values[pos]);
+				count++;
+			}
+
+			if (count) {
+				m_active_objs.push_back(m_objs[obj_idx]);
+				m_active_counts.push_back(count);
+			}
+		}
+
+		objs = &m_active_objs;
+		counts = &m_active_counts;
+		props = &m_active_props;
+		values = &m_active_values;
+	}
+
+	if (props->empty())
+		return 0;
+
+#ifdef DRM_IOCTL_MODE_ATOMIC
+	drm_mode_atomic atomic{};
+	atomic.flags = flags;
+	atomic.count_objs = objs->size();
+	atomic.objs_ptr = (uintptr_t)objs->data();
+	atomic.count_props_ptr = (uintptr_t)counts->data();
+	atomic.props_ptr = (uintptr_t)props->data();
+	atomic.prop_values_ptr = (uintptr_t)values->data();
+	atomic.user_data = (uintptr_t)data;
+
+	if (drmIoctl(m_card.fd(), DRM_IOCTL_MODE_ATOMIC, &atomic))
+		return -errno;
+
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
+
+int PreparedAtomicReq::test(bool allow_modeset)
+{
+	uint32_t flags = DRM_MODE_ATOMIC_TEST_ONLY;
+
+	if (allow_modeset)
+		flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+
+	return commit_flags(flags, 0);
+}
+
+int PreparedAtomicReq::commit(void* data, bool allow_modeset)
+{
+	uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK;
+
+	if (allow_modeset)
+		flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+
+	return commit_flags(flags, data);
+}
+
+int PreparedAtomicReq::commit_sync(bool allow_modeset)
+{
+	uint32_t flags = 0;
+
+	if (allow_modeset)
+		flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+
+	return commit_flags(flags, 0);
+}
 } // namespace kms
@@ -9,6 +9,10 @@
 #include <algorithm>
 #include <glob.h>
 
+#ifdef HAS_PTHREAD
+#include <thread>
+#endif
+
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 #include <sys/types.h>
@@ -220,26 +224,28 @@ void Card::setup()
 	r = drmGetCap(m_fd, DRM_CAP_DUMB_BUFFER, &has_dumb);
 	m_has_dumb = r == 0 && has_dumb;
 
+	m_lazy_props = getenv("KMSXX_LAZY_PROPS") != 0;
+
 	auto res = drmModeGetResources(m_fd);
 	if (res) {
 		for (int i = 0; i < res->count_connectors; ++i) {
 			uint32_t id = res->connectors[i];
 			auto ob = new Connector(*this, id, i);
-			m_obmap[id] = ob;
+			add_object(ob, ObjectKind::Connector, m_connectors.size());
 			m_connectors.push_back(ob);
 		}
 
 		for (int i = 0; i < res->count_crtcs; ++i) {
 			uint32_t id = res->crtcs[i];
 			auto ob = new Crtc(*this, id, i);
-			m_obmap[id] = ob;
+			add_object(ob, ObjectKind::Crtc, m_crtcs.size());
 			m_crtcs.push_back(ob);
 		}
 
 		for (int i = 0; i < res->count_encoders; ++i) {
 			uint32_t id = res->encoders[i];
 			auto ob = new Encoder(*this, id, i);
-			m_obmap[id] = ob;
+			add_object(ob, ObjectKind::Encoder, m_encoders.size());
 			m_encoders.push_back(ob);
 		}
 
@@ -250,7 +256,7 @@ void Card::setup()
 			for (uint i = 0; i < planeRes->count_planes; ++i) {
 				uint32_t id = planeRes->planes[i];
 				auto ob = new Plane(*this, id, i);
-				m_obmap[id] = ob;
+				add_object(ob, ObjectKind::Plane, m_planes.size());
 				m_planes.push_back(ob);
 			}
 
@@ -258,28 +264,68 @@ void Card::setup()
 		}
 	}
 
-	// collect all possible props
-	for (auto ob : get_objects()) {
-		auto props = drmModeObjectGetProperties(m_fd, ob->id(), ob->object_type());
+	for (auto ob : m_objects)
+		ob->setup();
+}
 
-		if (props == nullptr)
-			continue;
+void Card::add_object(DrmObject* ob, ObjectKind kind, uint32_t idx)
+{
+	// Keep the hash at most half full
+	if ((m_objects.size() + 1) * 2 > m_object_slots.size()) {
+		vector<ObjectSlot> old_slots(max<size_t>(m_object_slots.size() * 2, 64));
+		swap(old_slots, m_object_slots);
 
-		for (unsigned i = 0; i < props->count_props; ++i) {
-			uint32_t prop_id = props->props[i];
+		for (const ObjectSlot& slot : old_slots) {
+			if (slot.kind == ObjectKind::None)
+				continue;
 
-			if (m_obmap.find(prop_id) == m_obmap.end()) {
-				auto prop = new Property(*this, prop_id);
-				m_obmap[prop_id] = prop;
-				m_properties.push_back(prop);
-			}
+			const size_t mask = m_object_slots.size() - 1;
+			size_t i = (slot.id * 0x9e3779b1u) & mask;
+
+			while (m_object_slots[i].kind != ObjectKind::None)
+				i = (i + 1) & mask;
+
+			m_object_slots[i] = slot;
 		}
+	}
+
+	const size_t mask = m_object_slots.size() - 1;
+	size_t i = (ob->id() * 0x9e3779b1u) & mask;
+
+	while (m_object_slots[i].kind != ObjectKind::None)
+		i = (i + 1) & mask;
+
+	m_object_slots[i] = { ob->id(), kind, idx };
+
+	m_objects.insert(upper_bound(m_objects.begin(), m_objects.end(), ob,
+				     [](DrmObject* a, DrmObject* b) { return a->id() < b->id(); }),
+			 ob);
+}
+
+void Card::add_prop(uint32_t prop_id)
+{
+	if (find_object(prop_id))
+		return;
+
+	auto prop = new Property(*this, prop_id);
+	add_object(prop, ObjectKind::Property, m_properties.size());
+	m_properties.push_back(prop);
+}
 
-		drmModeFreeObjectProperties(props);
+const Card::ObjectSlot* Card::find_object(uint32_t id) const
+{
+	if (m_object_slots.empty())
+		return nullptr;
+
+	const size_t mask = m_object_slots.size() - 1;
+
+	for (size_t i = (id * 0x9e3779b1u) & mask; m_object_slots[i].kind != ObjectKind::None;
+	     i = (i + 1) & mask) {
+		if (m_object_slots[i].id == id)
+			return &m_object_slots[i];
 	}
 
-	for (auto pair : m_obmap)
-		pair.second->setup();
+	return nullptr;
 }
 
 Card::~Card()
@@ -289,8 +335,8 @@ Card::~Card()
 	while (m_framebuffers.size() > 0)
 		delete m_framebuffers.back();
 
-	for (auto pair : m_obmap)
-		delete pair.second;
+	for (auto ob : m_objects)
+		delete ob;
 
 	close(m_fd);
 }
@@ -322,41 +368,87 @@ Connector* Card::get_first_connected_connector() const
 	throw invalid_argument("no connected connectors");
 }
 
-DrmObject* Card::get_object(uint32_t id) const
+void Card::probe_connectors(const vector<Connector*>& connectors)
 {
-	auto iter = m_obmap.find(id);
-	if (iter != m_obmap.end())
-		return iter->second;
-	return nullptr;
+	const vector<Connector*>& conns = connectors.empty() ? m_connectors : connectors;
+	vector<drmModeConnectorPtr> probed(conns.size());
+
+	auto probe = [&](size_t i) {
+		probed[i] = drmModeGetConnector(m_fd, conns[i]->id());
+	};
+
+#ifdef HAS_PTHREAD
+	// The probes mostly wait on the hardware, e.g. on DDC transfers for
+	// EDID, so do them in threads of their own
+	if (conns.size() > 1) {
+		vector<thread> threads;
+
+		for (size_t i = 0; i < conns.size(); ++i)
+			threads.emplace_back(probe, i);
+
+		for (thread& t : threads)
+			t.join();
+	} else {
+		for (size_t i = 0; i < conns.size(); ++i)
+			probe(i);
+	}
+#else
+	for (size_t i = 0; i < conns.size(); ++i)
+		probe(i);
+#endif
+
+	// Updating the connectors may add properties, so do it in this thread
+	for (size_t i = 0; i < conns.size(); ++i)
+		conns[i]->update(probed[i]);
 }
 
-std::vector<kms::DrmObject*> Card::get_objects() const
+DrmObject* Card::get_object(uint32_t id) const
 {
-	vector<DrmObject*> v;
-	for (auto pair : m_obmap)
-		v.push_back(pair.second);
-	return v;
+	const ObjectSlot* slot = find_object(id);
+
+	if (!slot)
+		return nullptr;
+
+	switch (slot->kind) {
+	case ObjectKind::Connector:
+		return m_connectors[slot->idx];
+	case ObjectKind::Crtc:
+		return m_crtcs[slot->idx];
+	case ObjectKind::Encoder:
+		return m_encoders[slot->idx];
+	case ObjectKind::Plane:
+		return m_planes[slot->idx];
+	case ObjectKind::Property:
+		return m_properties[slot->idx];
+	default:
+		return nullptr;
+	}
 }
 
 Connector* Card::get_connector(uint32_t id) const
 {
-	return dynamic_cast<Connector*>(get_object(id));
+	const ObjectSlot* slot = find_object(id);
+	return slot && slot->kind == ObjectKind::Connector ? m_connectors[slot->idx] : nullptr;
 }
 Crtc* Card::get_crtc(uint32_t id) const
 {
-	return dynamic_cast<Crtc*>(get_object(id));
+	const ObjectSlot* slot = find_object(id);
+	return slot && slot->kind == ObjectKind::Crtc ? m_crtcs[slot->idx] : nullptr;
 }
 Encoder* Card::get_encoder(uint32_t id) const
 {
-	return dynamic_cast<Encoder*>(get_object(id));
+	const ObjectSlot* slot = find_object(id);
+	return slot && slot->kind == ObjectKind::Encoder ? m_encoders[slot->idx] : nullptr;
 }
 Property* Card::get_prop(uint32_t id) const
 {
-	return dynamic_cast<Property*>(get_object(id));
+	const ObjectSlot* slot = find_object(id);
+	return slot && slot->kind == ObjectKind::Property ? m_properties[slot->idx] : nullptr;
 }
 Plane* Card::get_plane(uint32_t id) const
 {
-	return dynamic_cast<Plane*>(get_object(id));
+	const ObjectSlot* slot = find_object(id);
+	return slot && slot->kind == ObjectKind::Plane ? m_planes[slot->idx] : nullptr;
 }
 
 std::vector<kms::Pipeline> Card::get_connected_pipelines()
@@ -409,19 +501,18 @@ void Card::call_page_flip_handlers()
 
 int Card::disable_all()
 {
+	static const PropKey active("ACTIVE");
+	static const PropKey fb_id("FB_ID");
+	static const PropKey crtc_id("CRTC_ID");
+
 	AtomicReq req(*this);
 
-	for (Crtc* c : m_crtcs) {
-		req.add(c, {
-				   { "ACTIVE", 0 },
-			   });
-	}
+	for (Crtc* c : m_crtcs)
+		req.add(c, active, 0);
 
 	for (Plane* p : m_planes) {
-		req.add(p, {
-				   { "FB_ID", 0 },
-				   { "CRTC_ID", 0 },
-			   });
+		req.add(p, fb_id, 0);
+		req.add(p, crtc_id, 0);
 	}
 
 	return req.commit_sync(true);
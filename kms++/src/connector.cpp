@@ -79,12 +79,15 @@ Connector::Connector(Card& card, uint32_t id, uint32_t idx)
 {
 	m_priv = new ConnectorPriv();
 
-	m_priv->drm_connector = drmModeGetConnector(this->card().fd(), this->id());
+	// Don't force a probe, which could wait on the hardware for long
+	m_priv->drm_connector = drmModeGetConnectorCurrent(this->card().fd(), this->id());
 	assert(m_priv->drm_connector);
 
-	// XXX drmModeGetConnector() does forced probe, which seems to change (at least) EDID blob id.
-	// XXX So refresh the props again here.
-	refresh_props();
+	// The kernel has no modes for a connector it has not probed yet, so probe
+	// it then. A disconnected connector has been probed, and has no modes.
+	if (m_priv->drm_connector->count_modes == 0 &&
+	    m_priv->drm_connector->connection != DRM_MODE_DISCONNECTED)
+		update(drmModeGetConnector(this->card().fd(), this->id()));
 
 	const auto& name = connector_names.at(m_priv->drm_connector->connector_type);
 	m_fullname = name + "-" + to_string(m_priv->drm_connector->connector_type_id);
@@ -98,10 +101,20 @@ Connector::~Connector()
 
 void Connector::refresh()
 {
-	drmModeFreeConnector(m_priv->drm_connector);
+	probe();
+}
 
-	m_priv->drm_connector = drmModeGetConnector(this->card().fd(), this->id());
-	assert(m_priv->drm_connector);
+void Connector::probe()
+{
+	update(drmModeGetConnector(this->card().fd(), this->id()));
+}
+
+void Connector::update(drmModeConnectorPtr drm_connector)
+{
+	assert(drm_connector);
+
+	drmModeFreeConnector(m_priv->drm_connector);
+	m_priv->drm_connector = drm_connector;
 
 	// XXX drmModeGetConnector() does forced probe, which seems to change (at least) EDID blob id.
 	// XXX So refresh the props again here.
@@ -19,7 +19,7 @@ DrmPropObject::DrmPropObject(Card& card, uint32_t object_type)
 DrmPropObject::DrmPropObject(Card& card, uint32_t id, uint32_t object_type, uint32_t idx)
 	: DrmObject(card, id, object_type, idx)
 {
-	refresh_props();
+	fetch_props();
 }
 
 DrmPropObject::~DrmPropObject()
@@ -27,9 +27,16 @@ DrmPropObject::~DrmPropObject()
 }
 
 void DrmPropObject::refresh_props()
+{
+	fetch_props();
+}
+
+void DrmPropObject::fetch_props()
 {
 	auto props = drmModeObjectGetProperties(card().fd(), this->id(), this->object_type());
 
+	m_key_index_built = false;
+
 	if (props == nullptr)
 		return;
 
@@ -37,22 +44,70 @@ void DrmPropObject::refresh_props()
 		uint32_t prop_id = props->props[i];
 		uint64_t prop_value = props->prop_values[i];
 
+		card().add_prop(prop_id);
+
 		m_prop_values[prop_id] = prop_value;
 	}
 
 	drmModeFreeObjectProperties(props);
+
+	if (!card().lazy_props())
+		key_props();
 }
 
-Property* DrmPropObject::get_prop(const string& name) const
+const map<uint32_t, uint64_t>& DrmPropObject::get_prop_map() const
+{
+	return m_prop_values;
+}
+
+const vector<Property*>& DrmPropObject::key_props() const
 {
+	if (m_key_index_built.load(memory_order_acquire))
+		return m_key_props;
+
+	lock_guard lock(m_key_index_mutex);
+
+	if (m_key_index_built.load(memory_order_relaxed))
+		return m_key_props;
+
+	m_key_props.clear();
+
+	// Interning the names of all our properties makes every key not in the
+	// index, now or created later, a name we don't have
 	for (auto pair : m_prop_values) {
 		auto prop = card().get_prop(pair.first);
+		PropKey key(prop->name());
+
+		if (key.index() >= m_key_props.size())
+			m_key_props.resize(key.index() + 1);
 
-		if (name == prop->name())
-			return prop;
+		m_key_props[key.index()] = prop;
 	}
 
-	return nullptr;
+	m_key_index_built.store(true, memory_order_release);
+
+	return m_key_props;
+}
+
+Property* DrmPropObject::get_prop(PropKey key) const
+{
+	const auto& props = key_props();
+
+	if (key.index() >= props.size())
+		return nullptr;
+
+	return props[key.index()];
+}
+
+Property* DrmPropObject::get_prop(const string& name) const
+{
+	// A name that has not been interned is not the name of any of our
+	// properties, as building the key index interned their names
+	key_props();
+
+	auto key = PropKey::find(name);
+
+	return key ? get_prop(*key) : nullptr;
 }
 
 uint64_t DrmPropObject::get_prop_value(uint32_t id) const
@@ -60,15 +115,24 @@ uint64_t DrmPropObject::get_prop_value(uint32_t id) const
 	return m_prop_values.at(id);
 }
 
+uint64_t DrmPropObject::get_prop_value(PropKey key) const
+{
+	Property* prop = get_prop(key);
+
+	if (prop == nullptr)
+		throw invalid_argument("property not found: " + key.name());
+
+	return m_prop_values.at(prop->id());
+}
+
 uint64_t DrmPropObject::get_prop_value(const string& name) const
 {
-	for (auto pair : m_prop_values) {
-		auto prop = card().get_prop(pair.first);
-		if (name == prop->name())
-			return m_prop_values.at(prop->id());
-	}
+	Property* prop = get_prop(name);
+
+	if (prop == nullptr)
+		throw invalid_argument("property not found: " + name);
 
-	throw invalid_argument("property not found: " + name);
+	return m_prop_values.at(prop->id());
 }
 
 unique_ptr<Blob> DrmPropObject::get_prop_value_as_blob(const string& name) const
@@ -88,6 +152,16 @@ int DrmPropObject::set_prop_value(uint32_t id, uint64_t value)
 	return drmModeObjectSetProperty(card().fd(), this->id(), this->object_type(), id, value);
 }
 
+int DrmPropObject::set_prop_value(PropKey key, uint64_t value)
+{
+	Property* prop = get_prop(key);
+
+	if (prop == nullptr)
+		throw invalid_argument("property not found: " + key.name());
+
+	return set_prop_value(prop->id(), value);
+}
+
 int DrmPropObject::set_prop_value(const string& name, uint64_t value)
 {
 	Property* prop = get_prop(name);
@@ -19,6 +19,22 @@ using namespace std;
 
 namespace kms
 {
+// Dumb buffers are mapped write-combined, except on the drivers backing them with
+// shmem, which map them cached
+static CpuCaching get_dumb_cpu_caching(const Card& card)
+{
+	static const char* const cached_drivers[] = {
+		"vkms", "vgem", "virtio_gpu", "simpledrm", "udl", "gud",
+	};
+
+	for (const char* name : cached_drivers) {
+		if (card.version_name() == name)
+			return CpuCaching::Cached;
+	}
+
+	return CpuCaching::WriteCombined;
+}
+
 DumbFramebuffer::DumbFramebuffer(Card& card, uint32_t width, uint32_t height, const string& fourcc)
 	: DumbFramebuffer(card, width, height, fourcc_str_to_pixel_format(fourcc))
 {
@@ -81,6 +97,8 @@ DumbFramebuffer::DumbFramebuffer(Card& card, uint32_t width, uint32_t height, Pi
 		throw invalid_argument(string("drmModeAddFB2 failed: ") + strerror(errno));
 
 	set_id(id);
+
+	set_cpu_caching(get_dumb_cpu_caching(card));
 }
 
 DumbFramebuffer::~DumbFramebuffer()
@@ -51,8 +51,10 @@ bool Plane::supports_format(PixelFormat fmt) const
 
 PlaneType Plane::plane_type() const
 {
+	static const PropKey type_key("type");
+
 	if (card().has_universal_planes()) {
-		switch (get_prop_value("type")) {
+		switch (get_prop_value(type_key)) {
 		case DRM_PLANE_TYPE_OVERLAY:
 			return PlaneType::Overlay;
 		case DRM_PLANE_TYPE_PRIMARY:
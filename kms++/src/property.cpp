@@ -1,3 +1,5 @@
+#include <mutex>
+
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
@@ -7,19 +9,48 @@ using namespace std;
 
 namespace kms
 {
+// The metadata of the property, copied out of the drmModePropertyRes
 struct PropertyPriv {
-	drmModePropertyPtr drm_prop;
+	string name;
+	PropertyType type;
+	uint32_t flags;
+	vector<uint64_t> values;
+	vector<pair<uint64_t, string>> enums;
+	vector<uint32_t> blob_ids;
+
+	once_flag fetched;
 };
 
 Property::Property(Card& card, uint32_t id)
 	: DrmObject(card, id, DRM_MODE_OBJECT_PROPERTY)
 {
 	m_priv = new PropertyPriv();
-	m_priv->drm_prop = drmModeGetProperty(card.fd(), id);
-	m_name = m_priv->drm_prop->name;
+
+	if (!card.lazy_props())
+		info();
+}
+
+Property::~Property()
+{
+	delete m_priv;
+}
+
+const PropertyPriv& Property::info() const
+{
+	call_once(m_priv->fetched, &Property::fetch_info, this);
+
+	return *m_priv;
+}
+
+void Property::fetch_info() const
+{
+	PropertyPriv& priv = *m_priv;
+
+	drmModePropertyPtr p = drmModeGetProperty(card().fd(), id());
+	if (!p)
+		throw invalid_argument("Failed to get property " + to_string(id()));
 
 	PropertyType t;
-	drmModePropertyPtr p = m_priv->drm_prop;
 	if (drm_property_type_is(p, DRM_MODE_PROP_BITMASK))
 		t = PropertyType::Bitmask;
 	else if (drm_property_type_is(p, DRM_MODE_PROP_BLOB))
@@ -32,54 +63,57 @@ Property::Property(Card& card, uint32_t id)
 		t = PropertyType::Range;
 	else if (drm_property_type_is(p, DRM_MODE_PROP_SIGNED_RANGE))
 		t = PropertyType::SignedRange;
-	else
+	else {
+		drmModeFreeProperty(p);
 		throw invalid_argument("Invalid property type");
+	}
 
-	m_type = t;
-}
+	priv.name = p->name;
+	priv.type = t;
+	priv.flags = p->flags;
+	priv.values.assign(p->values, p->values + p->count_values);
+	priv.blob_ids.assign(p->blob_ids, p->blob_ids + p->count_blobs);
 
-Property::~Property()
-{
-	drmModeFreeProperty(m_priv->drm_prop);
-	delete m_priv;
+	for (int i = 0; i < p->count_enums; ++i)
+		priv.enums.emplace_back(p->enums[i].value, p->enums[i].name);
+
+	drmModeFreeProperty(p);
 }
 
 const string& Property::name() const
 {
-	return m_name;
+	return info().name;
 }
 
 bool Property::is_immutable() const
 {
-	return m_priv->drm_prop->flags & DRM_MODE_PROP_IMMUTABLE;
+	return info().flags & DRM_MODE_PROP_IMMUTABLE;
 }
 
 bool Property::is_pending() const
 {
-	return m_priv->drm_prop->flags & DRM_MODE_PROP_PENDING;
+	return info().flags & DRM_MODE_PROP_PENDING;
+}
+
+PropertyType Property::type() const
+{
+	return info().type;
 }
 
 vector<uint64_t> Property::get_values() const
 {
-	drmModePropertyPtr p = m_priv->drm_prop;
-	return vector<uint64_t>(p->values, p->values + p->count_values);
+	return info().values;
 }
 
 map<uint64_t, string> Property::get_enums() const
 {
-	drmModePropertyPtr p = m_priv->drm_prop;
-
-	map<uint64_t, string> map;
-
-	for (int i = 0; i < p->count_enums; ++i)
-		map[p->enums[i].value] = string(p->enums[i].name);
+	const auto& enums = info().enums;
 
-	return map;
+	return map<uint64_t, string>(enums.begin(), enums.end());
 }
 
 vector<uint32_t> Property::get_blob_ids() const
 {
-	drmModePropertyPtr p = m_priv->drm_prop;
-	return vector<uint32_t>(p->blob_ids, p->blob_ids + p->count_blobs);
+	return info().blob_ids;
 }
 } // namespace kms
@@ -0,0 +1,77 @@
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include <kms++/kms++.h>
+
+using namespace std;
+
+namespace kms
+{
+namespace
+{
+struct PropKeyRegistry {
+	shared_mutex lock;
+	// deque, so that the names don't move when more are added
+	deque<string> names;
+	unordered_map<string_view, uint32_t> indices;
+};
+
+PropKeyRegistry& registry()
+{
+	static PropKeyRegistry reg;
+	return reg;
+}
+} // namespace
+
+PropKey::PropKey(string_view name)
+{
+	if (auto key = find(name)) {
+		m_index = key->m_index;
+		return;
+	}
+
+	auto& reg = registry();
+	lock_guard lock(reg.lock);
+
+	// Another thread may have interned the name in the meantime
+	auto iter = reg.indices.find(name);
+	if (iter != reg.indices.end()) {
+		m_index = iter->second;
+		return;
+	}
+
+	m_index = reg.names.size();
+	reg.names.emplace_back(name);
+	reg.indices[reg.names.back()] = m_index;
+}
+
+optional<PropKey> PropKey::find(string_view name)
+{
+	auto& reg = registry();
+	shared_lock lock(reg.lock);
+
+	auto iter = reg.indices.find(name);
+	if (iter == reg.indices.end())
+		return nullopt;
+
+	return PropKey(iter->second);
+}
+
+const string& PropKey::name() const
+{
+	auto& reg = registry();
+	shared_lock lock(reg.lock);
+
+	return reg.names[m_index];
+}
+
+uint32_t PropKey::count()
+{
+	auto& reg = registry();
+	shared_lock lock(reg.lock);
+
+	return reg.names.size();
+}
+} // namespace kms
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <kms++/kms++.h>
+#include <kms++util/color.h>
+
+namespace kms
+{
+/*
+ * Fills of rects, lines and circles in a framebuffer
+ *
+ * The format, plane mappings and strides are resolved once when the canvas is
+ * created, and colors are packed once into the bytes of one unit of pixels:
+ * a macropixel of the format, e.g. 2x2 pixels for NV12. The primitives then
+ * fill whole spans of rows with the packed bytes.
+ *
+ * The primitives are clipped to the framebuffer, and drawn in whole units, so
+ * their edges are rounded outwards to the unit grid in subsampled formats.
+ */
+class Canvas
+{
+public:
+	// A color packed for the canvas' format
+	struct Color {
+		struct Plane {
+			// unit_rows / vsub rows of the unit's bytes
+			std::vector<uint8_t> data;
+			uint32_t len;
+			bool uniform;
+		};
+
+		std::array<Plane, 4> planes;
+	};
+
+	Canvas(IFramebuffer& fb);
+
+	Canvas(const Canvas& other) = delete;
+	Canvas& operator=(const Canvas& other) = delete;
+
+	uint32_t width() const { return m_width; }
+	uint32_t height() const { return m_height; }
+
+	// The size of the units the primitives are drawn in
+	uint32_t unit_width() const { return m_unit_width; }
+	uint32_t unit_rows() const { return m_unit_rows; }
+
+	Color pack(RGB color) const;
+
+	void fill_rect(int32_t x, int32_t y, int32_t w, int32_t h, const Color& color);
+	void draw_hline(int32_t x1, int32_t x2, int32_t y, const Color& color);
+	void draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const Color& color);
+	void fill_circle(int32_t xc, int32_t yc, int32_t radius, const Color& color);
+
+	void fill_rect(int32_t x, int32_t y, int32_t w, int32_t h, RGB color)
+	{
+		fill_rect(x, y, w, h, pack(color));
+	}
+
+	void draw_hline(int32_t x1, int32_t x2, int32_t y, RGB color)
+	{
+		draw_hline(x1, x2, y, pack(color));
+	}
+
+	void draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2, RGB color)
+	{
+		draw_line(x1, y1, x2, y2, pack(color));
+	}
+
+	void fill_circle(int32_t xc, int32_t yc, int32_t radius, RGB color)
+	{
+		fill_circle(xc, yc, radius, pack(color));
+	}
+
+private:
+	struct Plane {
+		uint8_t* data;
+		uint32_t stride;
+		uint32_t vsub;
+		// Bytes per unit of pixels
+		uint32_t unit_bytes;
+	};
+
+	// Fill the unit aligned rect x1...x2-1, y1...y2-1
+	void fill_units(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, const Color& color);
+
+	IFramebuffer& m_fb;
+	PixelFormat m_format;
+	uint32_t m_width;
+	uint32_t m_height;
+	bool m_write_combined;
+
+	uint32_t m_unit_width;
+	uint32_t m_unit_rows;
+
+	unsigned m_num_planes;
+	std::array<Plane, 4> m_planes;
+
+	// A row of the fill, repeating a row of the unit's bytes
+	std::vector<uint8_t> m_span;
+};
+
+} // namespace kms
@@ -3,6 +3,8 @@
 #include <cmath>
 #include <cstdint>
 #include <algorithm>
+#include <array>
+#include <span>
 
 namespace kms
 {
@@ -181,4 +183,230 @@ constexpr RGB16 YUV16::to_rgb(RecStandard rec, ColorRange range) const noexcept
 		     static_cast<uint16_t>(std::round(std::clamp(b, 0.0, 1.0) * max_value)));
 }
 
+/*
+ * Fixed-point RGB16 <-> YUV16 conversion
+ *
+ * RGB16::to_yuv() and YUV16::to_rgb() work in double precision, which is far too
+ * slow to be used for every pixel of a frame. ColorConverter precomputes the same
+ * conversions as integer matrices with rounding offsets, and gives bit-identical
+ * results: the few results that land too close to a rounding tie to be resolved
+ * in fixed-point are recomputed with the double precision path.
+ */
+class ColorConverter
+{
+public:
+	constexpr ColorConverter(RecStandard rec, ColorRange range) noexcept;
+
+	// Returns a precomputed converter
+	static const ColorConverter& get(RecStandard rec, ColorRange range) noexcept;
+
+	RecStandard rec() const noexcept { return m_rec; }
+	ColorRange range() const noexcept { return m_range; }
+
+	[[nodiscard]]
+	constexpr YUV16 to_yuv(const RGB16& rgb) const noexcept;
+
+	[[nodiscard]]
+	constexpr RGB16 to_rgb(const YUV16& yuv) const noexcept;
+
+	// Convert a line. Runs of identical pixels are converted only once.
+	constexpr void to_yuv(std::span<const RGB16> src, std::span<YUV16> dst) const noexcept;
+	constexpr void to_rgb(std::span<const YUV16> src, std::span<RGB16> dst) const noexcept;
+
+private:
+	// Fractional bits in the matrices
+	static constexpr unsigned frac_bits = 40;
+	static constexpr int64_t frac_mask = (int64_t(1) << frac_bits) - 1;
+
+	// Results this close (in 1/2^frac_bits units) to a tie are handed to the double path
+	static constexpr int64_t tie_margin = int64_t(1) << (frac_bits - 20);
+
+	struct Matrix {
+		std::array<std::array<int64_t, 3>, 3> coeff;
+		std::array<int64_t, 3> offset;
+	};
+
+	static constexpr int64_t to_fixed(double v)
+	{
+		v *= static_cast<double>(int64_t(1) << frac_bits);
+		return static_cast<int64_t>(v < 0 ? v - 0.5 : v + 0.5);
+	}
+
+	static constexpr Matrix make_yuv_matrix(RecStandard rec, ColorRange range);
+	static constexpr Matrix make_rgb_matrix(RecStandard rec, ColorRange range);
+
+	// Multiply, round and clamp to 16 bits. Returns false if the rounding is ambiguous.
+	static constexpr bool apply(const Matrix& m, uint16_t c0, uint16_t c1, uint16_t c2,
+				    std::array<uint16_t, 3>& out) noexcept;
+
+	RecStandard m_rec;
+	ColorRange m_range;
+	Matrix m_to_yuv;
+	Matrix m_to_rgb;
+};
+
+constexpr ColorConverter::ColorConverter(RecStandard rec, ColorRange range) noexcept
+	: m_rec(rec), m_range(range), m_to_yuv(make_yuv_matrix(rec, range)),
+	  m_to_rgb(make_rgb_matrix(rec, range))
+{
+}
+
+constexpr ColorConverter::Matrix ColorConverter::make_yuv_matrix(RecStandard rec,
+								   ColorRange range)
+{
+	const auto coeff = ConversionCoefficients::get(rec);
+	const auto scaling = RangeScaling::get(range);
+
+	const double y_scale = scaling.y_max - scaling.y_min;
+	const double c_scale = scaling.c_max - scaling.c_min;
+	const double c_mid = (scaling.c_max + scaling.c_min) / 2.0;
+
+	// Rows produce Y, U and V from normalized R, G and B
+	const double m[3][3] = {
+		{ coeff.kr, coeff.kg, coeff.kb },
+		{ -coeff.kr / (2.0 * (1.0 - coeff.kb)), -coeff.kg / (2.0 * (1.0 - coeff.kb)), 0.5 },
+		{ 0.5, -coeff.kg / (2.0 * (1.0 - coeff.kr)), -coeff.kb / (2.0 * (1.0 - coeff.kr)) },
+	};
+
+	const double scale[3] = { y_scale, c_scale, c_scale };
+	const double base[3] = { scaling.y_min, c_mid, c_mid };
+
+	Matrix mat {};
+
+	for (size_t i = 0; i < 3; ++i) {
+		for (size_t j = 0; j < 3; ++j)
+			mat.coeff[i][j] = to_fixed(m[i][j] * scale[i]);
+
+		mat.offset[i] = to_fixed(base[i] * RGB16::max_value);
+	}
+
+	return mat;
+}
+
+constexpr ColorConverter::Matrix ColorConverter::make_rgb_matrix(RecStandard rec,
+								   ColorRange range)
+{
+	const auto coeff = ConversionCoefficients::get(rec);
+	const auto scaling = RangeScaling::get(range);
+
+	const double y_scale = scaling.y_max - scaling.y_min;
+	const double c_scale = scaling.c_max - scaling.c_min;
+	const double c_mid = (scaling.c_max + scaling.c_min) / 2.0;
+
+	// Rows produce R, G and B from normalized Y, U and V
+	const double m[3][3] = {
+		{ 1.0, 0.0, 2.0 * (1.0 - coeff.kr) },
+		{ 1.0, -2.0 * (1.0 - coeff.kb) * coeff.kb / coeff.kg,
+		  -2.0 * (1.0 - coeff.kr) * coeff.kr / coeff.kg },
+		{ 1.0, 2.0 * (1.0 - coeff.kb), 0.0 },
+	};
+
+	const double scale[3] = { y_scale, c_scale, c_scale };
+	const double base[3] = { scaling.y_min, c_mid, c_mid };
+
+	Matrix mat {};
+
+	for (size_t i = 0; i < 3; ++i) {
+		double offset = 0;
+
+		for (size_t j = 0; j < 3; ++j) {
+			mat.coeff[i][j] = to_fixed(m[i][j] / scale[j]);
+			offset -= m[i][j] * base[j] / scale[j];
+		}
+
+		mat.offset[i] = to_fixed(offset * YUV16::max_value);
+	}
+
+	return mat;
+}
+
+constexpr bool ColorConverter::apply(const Matrix& m, uint16_t c0, uint16_t c1, uint16_t c2,
+				     std::array<uint16_t, 3>& out) noexcept
+{
+	constexpr int64_t half = int64_t(1) << (frac_bits - 1);
+
+	bool exact = true;
+
+	for (size_t i = 0; i < 3; ++i) {
+		const int64_t v = m.coeff[i][0] * c0 + m.coeff[i][1] * c1 + m.coeff[i][2] * c2 +
+				  m.offset[i] + half;
+
+		exact &= ((v + tie_margin) & frac_mask) >= 2 * tie_margin;
+
+		out[i] = static_cast<uint16_t>(std::clamp<int64_t>(v >> frac_bits, 0, 0xffff));
+	}
+
+	return exact;
+}
+
+constexpr YUV16 ColorConverter::to_yuv(const RGB16& rgb) const noexcept
+{
+	std::array<uint16_t, 3> out;
+
+	if (!apply(m_to_yuv, rgb.r, rgb.g, rgb.b, out)) [[unlikely]]
+		return rgb.to_yuv(m_rec, m_range);
+
+	return YUV16(out[0], out[1], out[2]);
+}
+
+constexpr RGB16 ColorConverter::to_rgb(const YUV16& yuv) const noexcept
+{
+	std::array<uint16_t, 3> out;
+
+	if (!apply(m_to_rgb, yuv.y, yuv.u, yuv.v, out)) [[unlikely]]
+		return yuv.to_rgb(m_rec, m_range);
+
+	return RGB16(out[0], out[1], out[2]);
+}
+
+constexpr void ColorConverter::to_yuv(std::span<const RGB16> src,
+				      std::span<YUV16> dst) const noexcept
+{
+	RGB16 prev_rgb;
+	YUV16 prev_yuv = to_yuv(prev_rgb);
+
+	for (size_t x = 0; x < src.size(); ++x) {
+		const RGB16& rgb = src[x];
+
+		if (rgb.r != prev_rgb.r || rgb.g != prev_rgb.g || rgb.b != prev_rgb.b) {
+			prev_rgb = rgb;
+			prev_yuv = to_yuv(rgb);
+		}
+
+		dst[x] = prev_yuv;
+	}
+}
+
+constexpr void ColorConverter::to_rgb(std::span<const YUV16> src,
+				      std::span<RGB16> dst) const noexcept
+{
+	YUV16 prev_yuv;
+	RGB16 prev_rgb = to_rgb(prev_yuv);
+
+	for (size_t x = 0; x < src.size(); ++x) {
+		const YUV16& yuv = src[x];
+
+		if (yuv.y != prev_yuv.y || yuv.u != prev_yuv.u || yuv.v != prev_yuv.v) {
+			prev_yuv = yuv;
+			prev_rgb = to_rgb(yuv);
+		}
+
+		dst[x] = prev_rgb;
+	}
+}
+
+inline const ColorConverter& ColorConverter::get(RecStandard rec, ColorRange range) noexcept
+{
+	static constexpr ColorConverter converters[3][2] = {
+		{ { RecStandard::BT601, ColorRange::Limited }, { RecStandard::BT601, ColorRange::Full } },
+		{ { RecStandard::BT709, ColorRange::Limited }, { RecStandard::BT709, ColorRange::Full } },
+		{ { RecStandard::BT2020, ColorRange::Limited }, { RecStandard::BT2020, ColorRange::Full } },
+	};
+
+	const size_t rec_idx = rec == RecStandard::BT601 ? 0 : rec == RecStandard::BT2020 ? 2 : 1;
+	const size_t range_idx = range == ColorRange::Limited ? 0 : 1;
+
+	return converters[rec_idx][range_idx];
+}
+
 } // namespace kms
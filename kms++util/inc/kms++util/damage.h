@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <kms++/kms++.h>
+
+namespace kms
+{
+struct DamageRect {
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+/*
+ * A set of at most max_rects damaged rectangles. Overlapping and touching rects
+ * are merged, and when over the limit the two rects whose bounding rect grows
+ * the least are merged. The region may thus cover more than was damaged, but
+ * never less.
+ */
+class DamageRegion
+{
+public:
+	static constexpr size_t max_rects = 16;
+
+	void add(const DamageRect& rect);
+	void add(const DamageRegion& region);
+
+	void clear() { m_rects.clear(); }
+	bool empty() const { return m_rects.empty(); }
+	const std::vector<DamageRect>& rects() const { return m_rects; }
+
+private:
+	std::vector<DamageRect> m_rects;
+};
+
+/*
+ * Collects the damage drawn to a framebuffer. While a tracker exists for a
+ * framebuffer, the drawing functions (draw_rect(), draw_text(),
+ * draw_color_bar(), draw_test_pattern(), convert_framebuffer(), ...) add the
+ * areas they draw to it. A framebuffer can have only one tracker.
+ */
+class DamageTracker
+{
+public:
+	DamageTracker(IFramebuffer& fb);
+	~DamageTracker();
+
+	DamageTracker(const DamageTracker& other) = delete;
+	DamageTracker& operator=(const DamageTracker& other) = delete;
+
+	void add(const DamageRect& rect);
+
+	// Return the damage collected since the last call, and clear it
+	DamageRegion take();
+
+private:
+	friend void add_damage(IFramebuffer& fb, const DamageRect& rect);
+
+	IFramebuffer& m_fb;
+	DamageRegion m_region;
+};
+
+// Add damage to the tracker of fb, if any. The rect is clipped to fb.
+void add_damage(IFramebuffer& fb, const DamageRect& rect);
+// Damage the whole fb
+void add_damage(IFramebuffer& fb);
+
+// Set the FB_DAMAGE_CLIPS of plane to the region. Returns false if the plane
+// doesn't support damage clips. Nothing is added for an empty region.
+bool add_damage_clips(AtomicReq& req, Plane* plane, const DamageRegion& region);
+
+// Flush the damaged rects of fb with Framebuffer::flush(), for the legacy API
+void flush_damage(Framebuffer& fb, const DamageRegion& region);
+
+} // namespace kms
@@ -2,17 +2,23 @@
 
 #include <kms++/kms++.h>
 
+#include <kms++util/canvas.h>
 #include <kms++util/color.h>
 #include <kms++util/color16.h>
 #include <kms++util/strhelpers.h>
 #include <kms++util/cpuframebuffer.h>
+#include <kms++util/damage.h>
 #include <kms++util/extcpuframebuffer.h>
 #include <kms++util/stopwatch.h>
 #include <kms++util/opts.h>
 #include <kms++util/resourcemanager.h>
+#include <kms++util/testpatterncache.h>
+#include <kms++util/textrenderer.h>
 
 #include <cstdio>
 #include <cstdlib>
+#include <span>
+#include <vector>
 
 namespace kms
 {
@@ -37,11 +43,108 @@ struct TestPatternOptions {
 	std::string pattern;
 	RecStandard rec = RecStandard::BT709;
 	ColorRange range = ColorRange::Limited;
+
+	// Threads used by draw_test_pattern_multi(), 0 means hardware concurrency
+	unsigned num_threads = 0;
+	// CPUs for the worker threads, empty means no affinity
+	std::vector<unsigned> cpus;
+	// If set, draw_test_pattern() draws from the cache, and caches new frames
+	TestPatternCache* cache = nullptr;
 };
 
 void draw_test_pattern(IFramebuffer& fb, const TestPatternOptions& options = {});
 void draw_test_pattern_single(IFramebuffer& fb, const TestPatternOptions& options = {});
 void draw_test_pattern_multi(IFramebuffer& fb, const TestPatternOptions& options = {});
+
+// Fill the framebuffer with a color, using the rec, range and thread options
+void draw_solid_color(IFramebuffer& fb, const RGB16& color,
+		      const TestPatternOptions& options = {});
+
+// True if the test patterns can be drawn in the format
+bool test_pattern_supports_format(PixelFormat format);
+
+// Unpack the rows start_y...end_y to 16 bit per component pixels, fb.width() pixels
+// per row in dst. RGB and raw Bayer formats are read as RGB16, YUV and grayscale
+// formats as YUV16. The rows are read in parallel, num_threads 0 meaning hardware
+// concurrency.
+void read_framebuffer(IFramebuffer& fb, size_t start_y, size_t end_y, std::span<RGB16> dst,
+		      unsigned num_threads = 0);
+void read_framebuffer(IFramebuffer& fb, size_t start_y, size_t end_y, std::span<YUV16> dst,
+		      unsigned num_threads = 0);
+
+struct ConvertOptions {
+	// Used when converting between RGB and YUV
+	RecStandard rec = RecStandard::BT709;
+	ColorRange range = ColorRange::Limited;
+
+	// Threads used for the conversion, 0 means hardware concurrency
+	unsigned num_threads = 0;
+	// CPUs for the worker threads, empty means no affinity
+	std::vector<unsigned> cpus;
+};
+
+// Convert src to the format of dst, which must be of the same size. The rows are
+// converted in tiles, in parallel. Raw Bayer sources are not demosaiced.
+void convert_framebuffer(IFramebuffer& src, IFramebuffer& dst, const ConvertOptions& options = {});
+
+enum class ScaleFilter {
+	Bilinear,
+	// Catmull-Rom cubic, four taps per source pixel step
+	Polyphase,
+};
+
+struct ScaleOptions : ConvertOptions {
+	ScaleFilter filter = ScaleFilter::Polyphase;
+};
+
+// Scale src to the size and format of dst. The rows are scaled in tiles, in parallel.
+void scale_framebuffer(IFramebuffer& src, IFramebuffer& dst, const ScaleOptions& options = {});
+
+// The values of the KMS "pixel blend mode" plane property
+enum class BlendMode {
+	None,
+	Premultiplied,
+	Coverage,
+};
+
+// A framebuffer shown like a KMS plane
+struct CompositeLayer {
+	IFramebuffer* fb = nullptr;
+
+	// The source rect in fb, in whole pixels. A zero width or height means up to
+	// the edge of fb.
+	uint32_t src_x = 0;
+	uint32_t src_y = 0;
+	uint32_t src_w = 0;
+	uint32_t src_h = 0;
+
+	// The destination rect, which may extend outside the destination. A zero width
+	// or height means the source size.
+	int32_t dst_x = 0;
+	int32_t dst_y = 0;
+	uint32_t dst_w = 0;
+	uint32_t dst_h = 0;
+
+	unsigned zpos = 0;
+	// The plane alpha
+	uint16_t alpha = 0xffff;
+	BlendMode blend_mode = BlendMode::Premultiplied;
+};
+
+struct CompositeOptions : ScaleOptions {
+	// The color below the layers
+	RGB16 background = RGB16(0, 0, 0);
+};
+
+// Blend the layers over the background into dst, from the lowest zpos up, layers of
+// equal zpos in their order. Layers are scaled from their source to their destination
+// rects. The rows are composited in tiles, in parallel.
+void composite_framebuffers(std::span<const CompositeLayer> layers, IFramebuffer& dst,
+			    const CompositeOptions& options = {});
+
+// The SIMD instruction set the conversion kernels use on this CPU: "avx2",
+// "sse4.1", "neon" or "none"
+std::string get_simd_level();
 } // namespace kms
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <kms++/kms++.h>
+
+namespace kms
+{
+struct TestPatternOptions;
+
+/*
+ * An LRU cache of rendered test pattern frames, keyed by the framebuffer's size,
+ * format and strides, and the pattern options. Drawing a cached frame copies the
+ * planes to the framebuffer.
+ *
+ * If a directory is given, the frames are also stored there as files. Frames not
+ * in memory are then mapped from the files, also when stored by an earlier process.
+ */
+class TestPatternCache
+{
+public:
+	TestPatternCache(size_t max_bytes = 256 * 1024 * 1024, const std::string& dir = "");
+	~TestPatternCache();
+
+	TestPatternCache(const TestPatternCache& other) = delete;
+	TestPatternCache& operator=(const TestPatternCache& other) = delete;
+
+	// Draw the pattern, rendering and caching the frame if it's not in the cache
+	void draw(IFramebuffer& fb, const TestPatternOptions& options);
+
+	void clear();
+
+	size_t size_bytes() const;
+	size_t hits() const;
+	size_t misses() const;
+
+private:
+	struct Frame;
+
+	std::shared_ptr<Frame> find(const std::string& key);
+	std::shared_ptr<Frame> load(IFramebuffer& fb, const std::string& key);
+	std::shared_ptr<Frame> render(IFramebuffer& fb, const std::string& key,
+				      const TestPatternOptions& options);
+	static void get_plane_layout(IFramebuffer& fb, Frame& frame);
+	static void draw_frame(IFramebuffer& fb, Frame& frame, const TestPatternOptions& options);
+	static void copy_frame(const Frame& frame, IFramebuffer& fb,
+			       const TestPatternOptions& options);
+	void insert(const std::string& key, std::shared_ptr<Frame> frame);
+	std::string file_path(const std::string& key) const;
+
+	size_t m_max_bytes;
+	std::string m_dir;
+
+	mutable std::mutex m_mutex;
+	size_t m_bytes = 0;
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+
+	// Most recently used first
+	std::list<std::pair<std::string, std::shared_ptr<Frame>>> m_lru;
+	std::unordered_map<std::string, decltype(m_lru)::iterator> m_frames;
+};
+
+} // namespace kms
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <kms++/kms++.h>
+#include <kms++util/color.h>
+#include <kms++util/cpuframebuffer.h>
+
+namespace kms
+{
+/*
+ * Text in the 8x8 font. The glyphs are rasterized once for a format, colors and
+ * integer scale into an atlas, and strings are drawn by copying whole glyph rows
+ * from it.
+ */
+class TextRenderer
+{
+public:
+	TextRenderer(PixelFormat format, RGB fg, RGB bg = RGB(), unsigned scale = 1);
+
+	TextRenderer(const TextRenderer& other) = delete;
+	TextRenderer& operator=(const TextRenderer& other) = delete;
+
+	PixelFormat format() const { return m_atlas.format(); }
+	RGB fg() const { return m_fg; }
+	RGB bg() const { return m_bg; }
+	unsigned scale() const { return m_scale; }
+
+	uint32_t glyph_width() const { return m_glyph_size; }
+	uint32_t glyph_height() const { return m_glyph_size; }
+
+	// Draw str with its top left corner at x, y, rounded down to whole
+	// macropixels. Glyphs not fully inside the framebuffer are skipped.
+	void draw(IFramebuffer& fb, uint32_t x, uint32_t y, const std::string& str);
+
+private:
+	RGB m_fg;
+	RGB m_bg;
+	unsigned m_scale;
+	uint32_t m_glyph_size;
+
+	uint32_t m_unit_width;
+	uint32_t m_unit_rows;
+
+	// All the 256 glyphs side by side
+	CPUFramebuffer m_atlas;
+
+	// A row of the string being drawn
+	std::vector<uint8_t> m_span;
+};
+
+} // namespace kms
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kms
+{
+/*
+ * A persistent pool of worker threads for data parallel jobs.
+ *
+ * run() splits the task indices evenly between the workers and the calling
+ * thread. A thread that runs out of tasks steals half of the remaining tasks
+ * of the busiest thread, so uneven tasks don't leave threads idle.
+ */
+class ThreadPool
+{
+public:
+	// num_threads includes the thread calling run(). 0 means hardware concurrency.
+	// If cpus is not empty, the workers are pinned to the cpus, round-robin.
+	// If kms++util is built without threads, the pool always has one thread.
+	ThreadPool(unsigned num_threads = 0, const std::vector<unsigned>& cpus = {});
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	// A pool shared within kms++util, recreated only when a different thread
+	// count or affinity is asked for
+	static std::shared_ptr<ThreadPool> get_shared(unsigned num_threads = 0,
+						      const std::vector<unsigned>& cpus = {});
+
+	unsigned num_threads() const { return m_num_threads; }
+	const std::vector<unsigned>& cpus() const { return m_cpus; }
+
+	// Run func(0) ... func(num_tasks - 1) and wait for them to finish. If a task
+	// throws, the remaining tasks are skipped and the exception is rethrown here.
+	// A run() from within a task of the same pool runs its tasks in the calling
+	// thread.
+	void run(size_t num_tasks, const std::function<void(size_t task)>& func);
+
+private:
+	struct TaskRange {
+		std::mutex mutex;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	void worker_main(unsigned idx);
+	void run_tasks(unsigned idx);
+	bool get_task(unsigned idx, size_t& task);
+	bool steal_tasks(unsigned idx);
+	void stop_workers();
+
+	unsigned m_num_threads;
+	std::vector<unsigned> m_cpus;
+
+	std::vector<std::thread> m_workers;
+	std::unique_ptr<TaskRange[]> m_ranges;
+
+	// Serializes concurrent run() calls
+	std::mutex m_run_mutex;
+
+	std::mutex m_mutex;
+	std::condition_variable m_start_cv;
+	std::condition_variable m_done_cv;
+	uint64_t m_generation = 0;
+	unsigned m_busy_workers = 0;
+	bool m_stop = false;
+
+	const std::function<void(size_t)>* m_func = nullptr;
+	std::exception_ptr m_error;
+	std::atomic<bool> m_failed = false;
+};
+
+} // namespace kms
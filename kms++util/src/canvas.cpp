@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include <kms++/kms++.h>
+#include <kms++util/kms++util.h>
+
+#include "conv-store.h"
+
+using namespace std;
+
+namespace kms
+{
+static void draw_rect_pixels(IFramebuffer& fb, uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+			     RGB color)
+{
+	unsigned i, j;
+	YUV yuvcolor = color.yuv();
+
+	switch (fb.format()) {
+	case PixelFormat::XRGB8888:
+	case PixelFormat::XBGR8888:
+	case PixelFormat::ARGB8888:
+	case PixelFormat::ABGR8888:
+	case PixelFormat::RGB888:
+	case PixelFormat::BGR888:
+	case PixelFormat::RGB565:
+	case PixelFormat::BGR565:
+	case PixelFormat::XRGB4444:
+	case PixelFormat::XRGB1555:
+	case PixelFormat::ARGB4444:
+	case PixelFormat::ARGB1555:
+	case PixelFormat::RGB332:
+		for (j = 0; j < h; j++) {
+			for (i = 0; i < w; i++) {
+				draw_rgb_pixel(fb, x + i, y + j, color);
+			}
+		}
+		break;
+
+	case PixelFormat::YUV444:
+	case PixelFormat::YVU444:
+		for (j = 0; j < h; j++) {
+			for (i = 0; i < w; i++) {
+				draw_yuv444_pixel(fb, x + i, y + j, yuvcolor);
+			}
+		}
+		break;
+
+	case PixelFormat::UYVY:
+	case PixelFormat::YUYV:
+	case PixelFormat::YVYU:
+	case PixelFormat::VYUY:
+	case PixelFormat::NV16:
+	case PixelFormat::NV61:
+	case PixelFormat::YUV422:
+	case PixelFormat::YVU422:
+		for (j = 0; j < h; j++) {
+			for (i = 0; i < w; i += 2) {
+				draw_yuv422_macropixel(fb, x + i, y + j, yuvcolor, yuvcolor);
+			}
+		}
+		break;
+
+	case PixelFormat::NV12:
+	case PixelFormat::NV21:
+	case PixelFormat::YUV420:
+	case PixelFormat::YVU420:
+		for (j = 0; j < h; j += 2) {
+			for (i = 0; i < w; i += 2) {
+				draw_yuv420_macropixel(fb, x + i, y + j,
+						       yuvcolor, yuvcolor, yuvcolor, yuvcolor);
+			}
+		}
+		break;
+	default:
+		throw std::invalid_argument("draw_rect: unknown pixelformat");
+	}
+}
+
+Canvas::Canvas(IFramebuffer& fb)
+	: m_fb(fb), m_format(fb.format()), m_width(fb.width()), m_height(fb.height()),
+	  m_write_combined(fb.cpu_caching() == CpuCaching::WriteCombined),
+	  m_num_planes(fb.num_planes())
+{
+	const PixelFormatInfo& info = get_pixel_format_info(m_format);
+
+	// A unit is a whole macropixel of all the planes
+	m_unit_width = get<0>(info.pixel_align);
+	m_unit_rows = 1;
+	for (unsigned p = 0; p < m_num_planes; ++p) {
+		const PixelFormatPlaneInfo& pi = info.planes[p];
+
+		m_unit_width = lcm(m_unit_width, lcm((uint32_t)pi.hsub, (uint32_t)pi.pixels_per_block));
+		m_unit_rows = max(m_unit_rows, (uint32_t)pi.vsub);
+	}
+
+	for (unsigned p = 0; p < m_num_planes; ++p) {
+		m_planes[p] = {
+			fb.map(p),
+			fb.stride(p),
+			info.planes[p].vsub,
+			info.stride(m_unit_width, p),
+		};
+	}
+}
+
+Canvas::Color Canvas::pack(RGB color) const
+{
+	CPUFramebuffer unit(m_unit_width, m_unit_rows, m_format);
+
+	draw_rect_pixels(unit, 0, 0, m_unit_width, m_unit_rows, color);
+
+	Color packed;
+
+	for (unsigned p = 0; p < m_num_planes; ++p) {
+		Color::Plane& cp = packed.planes[p];
+		const uint32_t rows = m_unit_rows / m_planes[p].vsub;
+
+		cp.len = m_planes[p].unit_bytes;
+
+		for (uint32_t r = 0; r < rows; ++r) {
+			const uint8_t* src = unit.map(p) + r * unit.stride(p);
+			cp.data.insert(cp.data.end(), src, src + cp.len);
+		}
+
+		cp.uniform = all_of(cp.data.begin(), cp.data.end(),
+				    [&cp](uint8_t v) { return v == cp.data[0]; });
+	}
+
+	return packed;
+}
+
+void Canvas::fill_units(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, const Color& color)
+{
+	add_damage(m_fb, { x1, y1, x2 - x1, y2 - y1 });
+
+	for (unsigned p = 0; p < m_num_planes; ++p) {
+		const Plane& plane = m_planes[p];
+		const Color::Plane& cp = color.planes[p];
+		const uint32_t rows = m_unit_rows / plane.vsub;
+		const size_t offset = (size_t)x1 / m_unit_width * plane.unit_bytes;
+		const size_t len = (size_t)(x2 - x1) / m_unit_width * plane.unit_bytes;
+		const uint32_t r1 = y1 / plane.vsub;
+		const uint32_t r2 = y2 / plane.vsub;
+
+		if (cp.uniform) {
+			for (uint32_t r = r1; r < r2; ++r)
+				memset(plane.data + r * plane.stride + offset, cp.data[0], len);
+			continue;
+		}
+
+		// Fill the span of each row of the unit once, and copy it to the
+		// framebuffer rows with that row of the unit
+		for (uint32_t i = 0; i < rows; ++i) {
+			m_span.resize(len);
+
+			memcpy(m_span.data(), cp.data.data() + i * cp.len, cp.len);
+			for (size_t n = cp.len; n < len; n *= 2)
+				memcpy(m_span.data() + n, m_span.data(), min(n, len - n));
+
+			for (uint32_t r = r1 + i; r < r2; r += rows) {
+				uint8_t* dst = plane.data + r * plane.stride + offset;
+
+				if (m_write_combined)
+					stream_copy(dst, m_span.data(), len);
+				else
+					memcpy(dst, m_span.data(), len);
+			}
+		}
+	}
+}
+
+void Canvas::fill_rect(int32_t x, int32_t y, int32_t w, int32_t h, const Color& color)
+{
+	if (w <= 0 || h <= 0)
+		return;
+
+	// Clip to the whole units in the framebuffer, rounding the edges outwards
+	const uint32_t max_x = m_width / m_unit_width * m_unit_width;
+	const uint32_t max_y = m_height / m_unit_rows * m_unit_rows;
+
+	const int64_t x1 = max<int64_t>(x, 0);
+	const int64_t y1 = max<int64_t>(y, 0);
+	const int64_t x2 = min<int64_t>((int64_t)x + w, m_width);
+	const int64_t y2 = min<int64_t>((int64_t)y + h, m_height);
+
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	const uint32_t ux1 = x1 / m_unit_width * m_unit_width;
+	const uint32_t uy1 = y1 / m_unit_rows * m_unit_rows;
+	const uint32_t ux2 = min<uint32_t>((x2 + m_unit_width - 1) / m_unit_width * m_unit_width, max_x);
+	const uint32_t uy2 = min<uint32_t>((y2 + m_unit_rows - 1) / m_unit_rows * m_unit_rows, max_y);
+
+	if (ux1 >= ux2 || uy1 >= uy2)
+		return;
+
+	fill_units(ux1, uy1, ux2, uy2, color);
+}
+
+void Canvas::draw_hline(int32_t x1, int32_t x2, int32_t y, const Color& color)
+{
+	if (x1 > x2)
+		swap(x1, x2);
+
+	fill_rect(x1, y, x2 - x1 + 1, 1, color);
+}
+
+void Canvas::draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const Color& color)
+{
+	// Bresenham, filling the horizontal runs of each row at once
+	const int32_t dx = abs(x2 - x1);
+	const int32_t dy = -abs(y2 - y1);
+	const int32_t sx = x1 < x2 ? 1 : -1;
+	const int32_t sy = y1 < y2 ? 1 : -1;
+	int32_t err = dx + dy;
+	int32_t run_x = x1;
+
+	while (x1 != x2 || y1 != y2) {
+		const int32_t e2 = 2 * err;
+		int32_t nx = x1;
+		int32_t ny = y1;
+
+		if (e2 >= dy) {
+			err += dy;
+			nx += sx;
+		}
+
+		if (e2 <= dx) {
+			err += dx;
+			ny += sy;
+		}
+
+		if (ny != y1) {
+			draw_hline(run_x, x1, y1, color);
+			run_x = nx;
+		}
+
+		x1 = nx;
+		y1 = ny;
+	}
+
+	draw_hline(run_x, x1, y1, color);
+}
+
+void Canvas::fill_circle(int32_t xc, int32_t yc, int32_t radius, const Color& color)
+{
+	const int32_t r2 = radius * radius;
+
+	for (int32_t y = -radius; y <= radius; y++) {
+		int32_t x = (int32_t)(sqrt(r2 - y * y) + 0.5);
+		draw_hline(xc - x, xc + x, yc - y, color);
+	}
+}
+
+} // namespace kms
@@ -106,6 +106,10 @@ void draw_color_bar(IFramebuffer& buf, int old_xpos, int xpos, int width)
 	if (old_xpos >= 0 && old_xpos + width > (int)buf.width())
 		old_xpos = -1;
 
+	if (old_xpos >= 0)
+		add_damage(buf, { (uint32_t)old_xpos, 0, (uint32_t)width, buf.height() });
+	add_damage(buf, { (uint32_t)xpos, 0, (uint32_t)width, buf.height() });
+
 	switch (buf.format()) {
 	case PixelFormat::NV12:
 	case PixelFormat::NV21:
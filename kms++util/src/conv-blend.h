@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <kms++util/kms++util.h>
+
+#include "conv-simd.h"
+
+namespace kms
+{
+
+/*
+ * Blending
+ *
+ * A layer line of RGB16 pixels is blended over the destination line in place, as
+ * the KMS "pixel blend mode" property defines it, with pa the plane alpha and fa
+ * the pixel alpha:
+ *
+ *   None:          out = pa * fg + (1 - pa) * bg
+ *   Premultiplied: out = pa * fg + (1 - pa * fa) * bg
+ *   Coverage:      out = pa * fa * fg + (1 - pa * fa) * bg
+ *
+ * The alpha of the output is (pa * fa) + (1 - pa * fa) * bg alpha, fa being 1 for
+ * None. The products are rounded 16-bit fixed point, and the sums saturated.
+ *
+ * The pixels are blended in 32-bit lanes, two or four at a time with SSE4.1 and
+ * AVX2, and in 16-bit lanes with NEON's widening multiplies. The x86 variants are
+ * picked at runtime, as with the line packers.
+ */
+
+// Rounded a * b / 0xffff
+inline uint32_t blend_mul(uint32_t a, uint32_t b)
+{
+	const uint32_t t = a * b + 0x8000;
+	return (t + (t >> 16)) >> 16;
+}
+
+inline void blend_pixel(uint16_t* dst, const uint16_t* src, uint32_t pa, BlendMode mode)
+{
+	const uint32_t fa = mode == BlendMode::None ? 0xffff : src[3];
+	const uint32_t k = blend_mul(pa, fa);
+	const uint32_t src_mul = mode == BlendMode::Coverage ? k : pa;
+	const uint32_t inv = 0xffff - k;
+
+	for (unsigned ch = 0; ch < 3; ch++)
+		dst[ch] = std::min<uint32_t>(blend_mul(src[ch], src_mul) + blend_mul(dst[ch], inv),
+					     0xffff);
+
+	dst[3] = std::min<uint32_t>(k + blend_mul(dst[3], inv), 0xffff);
+}
+
+#if defined(KMSXX_X86_SIMD)
+// Rounded a * b / 0xffff in the 32-bit lanes
+__attribute__((target("sse4.1"))) inline __m128i blend_mul_sse41(__m128i a, __m128i b)
+{
+	__m128i t = _mm_add_epi32(_mm_mullo_epi32(a, b), _mm_set1_epi32(0x8000));
+	return _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 16)), 16);
+}
+
+__attribute__((target("avx2"))) inline __m256i blend_mul_avx2(__m256i a, __m256i b)
+{
+	__m256i t = _mm256_add_epi32(_mm256_mullo_epi32(a, b), _mm256_set1_epi32(0x8000));
+	return _mm256_srli_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 16)), 16);
+}
+
+// Blend a pixel widened to 32-bit lanes, with plane alpha pa in all lanes
+__attribute__((target("sse4.1"))) inline __m128i blend_pixel_sse41(__m128i src, __m128i dst,
+								   __m128i pa, BlendMode mode)
+{
+	const __m128i k = mode == BlendMode::None
+				  ? pa
+				  : blend_mul_sse41(pa, _mm_shuffle_epi32(src, _MM_SHUFFLE(3, 3, 3, 3)));
+	const __m128i src_mul = mode == BlendMode::Coverage ? k : pa;
+
+	// The alpha lane gets pa * fa
+	const __m128i out_src = _mm_blend_epi16(blend_mul_sse41(src, src_mul), k, 0xc0);
+
+	return _mm_add_epi32(out_src,
+			     blend_mul_sse41(dst, _mm_sub_epi32(_mm_set1_epi32(0xffff), k)));
+}
+
+// As blend_pixel_sse41(), a pixel in each 128-bit lane
+__attribute__((target("avx2"))) inline __m256i blend_pixels_avx2(__m256i src, __m256i dst,
+								 __m256i pa, BlendMode mode)
+{
+	const __m256i k = mode == BlendMode::None
+				  ? pa
+				  : blend_mul_avx2(pa, _mm256_shuffle_epi32(src, _MM_SHUFFLE(3, 3, 3, 3)));
+	const __m256i src_mul = mode == BlendMode::Coverage ? k : pa;
+
+	const __m256i out_src = _mm256_blend_epi32(blend_mul_avx2(src, src_mul), k, 0x88);
+
+	return _mm256_add_epi32(out_src,
+				blend_mul_avx2(dst, _mm256_sub_epi32(_mm256_set1_epi32(0xffff), k)));
+}
+
+// Blend the pixels from x on, two at a time. Returns the number of pixels done.
+__attribute__((target("sse4.1"))) inline size_t blend_line_sse41(uint16_t* dst, const uint16_t* src,
+								 size_t n, uint16_t pa,
+								 BlendMode mode, size_t x)
+{
+	const __m128i va = _mm_set1_epi32(pa);
+
+	for (; x + 2 <= n; x += 2) {
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x * 4));
+
+		__m128i lo = blend_pixel_sse41(_mm_cvtepu16_epi32(s), _mm_cvtepu16_epi32(d), va, mode);
+		__m128i hi = blend_pixel_sse41(_mm_cvtepu16_epi32(_mm_srli_si128(s, 8)),
+					       _mm_cvtepu16_epi32(_mm_srli_si128(d, 8)), va, mode);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi32(lo, hi));
+	}
+
+	return x;
+}
+
+// As blend_line_sse41(), four pixels at a time
+__attribute__((target("avx2"))) inline size_t blend_line_avx2(uint16_t* dst, const uint16_t* src,
+							      size_t n, uint16_t pa, BlendMode mode)
+{
+	const __m256i va = _mm256_set1_epi32(pa);
+	size_t x = 0;
+
+	for (; x + 4 <= n; x += 4) {
+		__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+		__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x * 4));
+
+		__m256i lo = blend_pixels_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(s)),
+					       _mm256_cvtepu16_epi32(_mm256_castsi256_si128(d)),
+					       va, mode);
+		__m256i hi = blend_pixels_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(s, 1)),
+					       _mm256_cvtepu16_epi32(_mm256_extracti128_si256(d, 1)),
+					       va, mode);
+
+		// packus works within the 128-bit lanes, put the quadwords back in order
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi),
+							  _MM_SHUFFLE(3, 1, 2, 0));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), packed);
+	}
+
+	return blend_line_sse41(dst, src, n, pa, mode, x);
+}
+#endif
+
+// Blend n pixels of src over dst, with plane alpha pa
+inline void blend_line(RGB16* dst_pixels, const RGB16* src_pixels, size_t n, uint16_t pa,
+		       BlendMode mode)
+{
+	uint16_t* dst = reinterpret_cast<uint16_t*>(dst_pixels);
+	const uint16_t* src = reinterpret_cast<const uint16_t*>(src_pixels);
+	size_t x = 0;
+
+	if (pa == 0)
+		return;
+
+	if (mode == BlendMode::None && pa == 0xffff) {
+		std::copy(src_pixels, src_pixels + n, dst_pixels);
+		return;
+	}
+
+#if defined(__ARM_NEON)
+	const uint16x4_t va = vdup_n_u16(pa);
+	const uint16x4_t alpha_mask = vcreate_u16(0xffff000000000000ull);
+
+	for (; x + 2 <= n; x += 2) {
+		const uint16x8_t s = vld1q_u16(src + x * 4);
+		const uint16x8_t d = vld1q_u16(dst + x * 4);
+		uint16x4_t out[2];
+
+		for (unsigned i = 0; i < 2; i++) {
+			const uint16x4_t sv = i ? vget_high_u16(s) : vget_low_u16(s);
+			const uint16x4_t dv = i ? vget_high_u16(d) : vget_low_u16(d);
+
+			// Rounded products divided by 0xffff
+			auto mul = [](uint16x4_t a, uint16x4_t b) {
+				uint32x4_t t = vaddq_u32(vmull_u16(a, b), vdupq_n_u32(0x8000));
+				return vaddhn_u32(t, vshrq_n_u32(t, 16));
+			};
+
+			uint16x4_t k = va;
+			if (mode != BlendMode::None)
+				k = mul(va, vdup_lane_u16(sv, 3));
+
+			const uint16x4_t src_mul = mode == BlendMode::Coverage ? k : va;
+			const uint16x4_t out_src = vbsl_u16(alpha_mask, k, mul(sv, src_mul));
+			const uint16x4_t out_dst = mul(dv, vsub_u16(vdup_n_u16(0xffff), k));
+
+			out[i] = vqadd_u16(out_src, out_dst);
+		}
+
+		vst1q_u16(dst + x * 4, vcombine_u16(out[0], out[1]));
+	}
+#elif defined(KMSXX_X86_SIMD)
+	switch (x86_simd_level()) {
+	case X86SimdLevel::AVX2:
+		x = blend_line_avx2(dst, src, n, pa, mode);
+		break;
+	case X86SimdLevel::SSE41:
+		x = blend_line_sse41(dst, src, n, pa, mode, 0);
+		break;
+	default:
+		break;
+	}
+#endif
+
+	for (; x < n; x++)
+		blend_pixel(dst + x * 4, src + x * 4, pa, mode);
+}
+
+} // namespace kms
@@ -105,6 +105,8 @@ struct PlaneLayout {
 	template<size_t N>
 	static constexpr size_t component_size = std::tuple_element_t<N, components_tuple>::size;
 
+	static constexpr size_t max_component_size = std::max({ Components::size... });
+
 	using storage_type = TStorage;
 
 	static constexpr std::array<ComponentType, sizeof...(Components)> order = {
@@ -171,6 +173,8 @@ class FormatLayout
 public:
 	static constexpr size_t num_planes = sizeof...(Planes);
 
+	static constexpr size_t max_component_size = std::max({ Planes::max_component_size... });
+
 	template<size_t N> using plane = std::tuple_element_t<N, std::tuple<Planes...>>;
 };
 
@@ -6,6 +6,8 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-rowmemo.h"
+#include "conv-spans.h"
 
 namespace kms
 {
@@ -86,18 +88,28 @@ public:
 				  auto&& generate_line)
 	{
 		std::vector<YUV16> linebuf(fb.width());
+		LineSpans<YUV16> spans;
 
 		// View to the plane
 		auto view = make_strided_fb_view<TStorage>(fb.map(0), fb.height(),
 							   fb.width() / pixels_in_group,
 							   fb.stride(0));
 
+		RowMemo<1> memo(fb);
+
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
-			generate_line(y_src, linebuf);
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
 
 			auto dst = md::submdspan(view, y_src, md::full_extent);
 
-			pack_line(dst, linebuf, fb.width());
+			if constexpr (!is_packed_format) {
+				write_line<Plane, YUV16>(reinterpret_cast<uint8_t*>(&dst[0]), y_src,
+							 generate_line, std::span(linebuf), spans);
+			} else {
+				generate_line(y_src, linebuf);
+				pack_line(dst, linebuf, fb.width());
+			}
 		}
 	}
 
@@ -127,4 +139,47 @@ private:
 	}
 };
 
+template<typename Layout> class Y_Reader
+{
+	using Plane = typename Layout::template plane<0>;
+	using TStorage = typename Plane::storage_type;
+
+	static constexpr size_t pixels_in_group =
+		Plane::template component_count<ComponentType::Y>();
+
+	// Neutral chroma
+	static constexpr uint16_t uv_value = 0x8000;
+
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0.
+	// The pixels get neutral chroma.
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<YUV16> auto&& dest)
+	{
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
+		if (fb.width() % pixels_in_group != 0)
+			throw std::invalid_argument("FB width doesn't align to pixel format");
+
+		for (size_t y = start_y; y <= end_y; y++) {
+			auto dst = md::submdspan(dest, y - start_y, md::full_extent);
+			auto src = reinterpret_cast<const TStorage*>(fb.map(0) + y * fb.stride(0));
+
+			for (size_t x = 0; x < fb.width(); x += pixels_in_group) {
+				const auto components = Plane::unpack(src[x / pixels_in_group]);
+
+				static_for<0, pixels_in_group>([&](auto i) {
+					constexpr size_t idx = Plane::template find_nth_pos<ComponentType::Y>(i);
+
+					dst[x + i] = YUV16 {
+						static_cast<uint16_t>(components[idx]
+								      << (16 - Plane::template component_size<idx>)),
+						uv_value, uv_value,
+					};
+				});
+			}
+		}
+	}
+};
+
 } // namespace kms
\ No newline at end of file
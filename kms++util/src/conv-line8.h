@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <kms++util/color16.h>
+
+#include "conv-common.h"
+#include "conv-spans.h"
+
+namespace kms
+{
+
+/*
+ * 8-bit writing from spans
+ *
+ * Writers of layouts whose components are all 8 bits or less pack their storage
+ * units straight from the generator's spans, without filling 16-bit line buffers.
+ *
+ * A unit packs a group of pixels from one or more rows, e.g. a YUYV pixel pair or
+ * the 2x2 pixels of an NV12 chroma sample. Where all the rows are solid over a run
+ * of groups, the unit is packed once, from the span colors, and its bytes are
+ * replicated over the run. Only the groups crossing span edges and the groups in
+ * other spans (e.g. ramps) are packed one by one. The units are always packed from
+ * the 16-bit pixels, so subsampled chroma is averaged before dropping the low
+ * bits, and the output is identical to packing full lines.
+ */
+
+template<typename Layout>
+constexpr bool is_8bit_layout = Layout::max_component_size <= 8;
+
+// A line described by the generator's spans. The pixels of the non-solid spans
+// are in the line buffer.
+template<typename TPixel>
+class SpanLine
+{
+public:
+	SpanLine(size_t width)
+		: m_width(width), m_line(width)
+	{
+	}
+
+	size_t width() const { return m_width; }
+	const LineSpans<TPixel>& spans() const { return m_spans; }
+	const TPixel* pixels() const { return m_line.data(); }
+
+	// The pixel at x, looking up its span
+	TPixel pixel(size_t x) const
+	{
+		for (const auto& span : m_spans) {
+			if (x < span.end)
+				return span.solid ? span.color : m_line[x];
+		}
+
+		return m_line[x];
+	}
+
+	// Generate line y. Generators without spans fill the whole line buffer.
+	void generate(size_t y, auto&& generate_line)
+	{
+		m_spans.clear();
+
+		if constexpr (has_line_spans<std::remove_cvref_t<decltype(generate_line)>, TPixel>) {
+			generate_line.describe_line(y, std::span(m_line), m_spans);
+		} else {
+			generate_line(y, std::span(m_line));
+			m_spans.push_back({ 0, m_width, false, {} });
+		}
+	}
+
+private:
+	size_t m_width;
+	std::vector<TPixel> m_line;
+	LineSpans<TPixel> m_spans;
+};
+
+// Replicate the unit_bytes bytes of unit count times to dst
+inline void fill_units(uint8_t* dst, const uint8_t* unit, size_t unit_bytes, size_t count)
+{
+	if (unit_bytes == 1) {
+		memset(dst, unit[0], count);
+		return;
+	}
+
+	constexpr size_t pattern_bytes = 256;
+	uint8_t pattern[pattern_bytes];
+
+	const size_t pattern_units = std::min(count, pattern_bytes / unit_bytes);
+
+	for (size_t i = 0; i < pattern_units; i++)
+		memcpy(pattern + i * unit_bytes, unit, unit_bytes);
+
+	for (size_t i = 0; i < count; i += pattern_units)
+		memcpy(dst + i * unit_bytes, pattern,
+		       std::min(pattern_units, count - i) * unit_bytes);
+}
+
+/*
+ * Pack num_groups groups of group_width pixels, from the lines, to units of
+ * unit_bytes bytes at dst. pack_group(pixels, unit) packs the pixels of a group,
+ * pixels[row][i], to the unit.
+ */
+template<size_t group_width, size_t unit_bytes, typename TPixel, size_t num_rows>
+void pack_span_groups(const std::array<const SpanLine<TPixel>*, num_rows>& lines,
+		      size_t num_groups, uint8_t* dst, auto&& pack_group)
+{
+	using Group = std::array<std::array<TPixel, group_width>, num_rows>;
+
+	const size_t width = num_groups * group_width;
+
+	// The span of each row at the current position
+	std::array<size_t, num_rows> span_idx {};
+
+	auto span_of = [&](size_t row, size_t x) -> const LineSpan<TPixel>& {
+		const auto& spans = lines[row]->spans();
+
+		while (spans[span_idx[row]].end <= x)
+			span_idx[row]++;
+
+		return spans[span_idx[row]];
+	};
+
+	size_t x = 0;
+
+	while (x < width) {
+		// The end of the run where all the rows are solid, starting at x
+		size_t run_end = width;
+		bool solid = true;
+
+		for (size_t row = 0; row < num_rows; row++) {
+			const auto& span = span_of(row, x);
+
+			solid = solid && span.solid;
+			run_end = std::min(run_end, span.end);
+		}
+
+		const size_t run_groups = solid ? (run_end - x) / group_width : 0;
+
+		if (run_groups > 0) {
+			Group group;
+
+			for (size_t row = 0; row < num_rows; row++)
+				group[row].fill(span_of(row, x).color);
+
+			uint8_t unit[unit_bytes];
+			pack_group(group, unit);
+
+			fill_units(dst + x / group_width * unit_bytes, unit, unit_bytes, run_groups);
+
+			x += run_groups * group_width;
+			continue;
+		}
+
+		// A single group, crossing span edges or in non-solid spans
+		Group group;
+
+		for (size_t row = 0; row < num_rows; row++) {
+			for (size_t i = 0; i < group_width; i++) {
+				const auto& span = span_of(row, x + i);
+
+				group[row][i] = span.solid ? span.color : lines[row]->pixels()[x + i];
+			}
+		}
+
+		pack_group(group, dst + x / group_width * unit_bytes);
+
+		x += group_width;
+	}
+}
+
+} // namespace kms
@@ -6,7 +6,10 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-rowmemo.h"
 #include "conv-raw.h"
+#include "conv-raw-simd.h"
+#include "conv-simd.h"
 
 namespace kms
 {
@@ -57,9 +60,14 @@ using SGBRG12P_Layout = BayerPacked12_Layout<BayerOrder::GBRG>;
 using SGRBG12P_Layout = BayerPacked12_Layout<BayerOrder::GRBG>;
 using SBGGR12P_Layout = BayerPacked12_Layout<BayerOrder::BGGR>;
 
+template<typename Layout>
+class BayerPacked_Reader;
+
 template<typename Layout>
 class BayerPacked_Writer
 {
+	friend class BayerPacked_Reader<Layout>;
+
 	using Plane = typename Layout::template plane<0>;
 	using TStorage = typename Plane::storage_type;
 
@@ -68,8 +76,6 @@ class BayerPacked_Writer
 
 	static constexpr BayerOrder bayer_order = Layout::bayer_order;
 	static constexpr size_t bit_depth = Layout::bit_depth;
-	static constexpr size_t pixels_per_group = Layout::pixels_per_group;
-	static constexpr size_t bytes_per_group = Layout::bytes_per_group;
 
 	static constexpr ComponentType get_bayer_component(size_t x, size_t y)
 	{
@@ -105,104 +111,24 @@ class BayerPacked_Writer
 		return ComponentType::Y; // fallback
 	}
 
-	static uint16_t extract_component(const RGB16& pix, ComponentType component)
-	{
-		switch (component) {
-		case ComponentType::R:
-			return pix.r;
-		case ComponentType::G:
-			return pix.g;
-		case ComponentType::B:
-			return pix.b;
-		default:
-			return 0;
-		}
-	}
+	using Packer = BayerLinePacker<bit_depth>;
 
-	// Pack 10-bit pixels: 4 pixels (40 bits) into 5 bytes
-	static void pack_10bit_group(uint8_t* dst, const std::array<uint16_t, 4>& values)
-	{
-		// Convert from 16-bit to 10-bit values
-		const uint16_t p0 = values[0] >> 6;
-		const uint16_t p1 = values[1] >> 6;
-		const uint16_t p2 = values[2] >> 6;
-		const uint16_t p3 = values[3] >> 6;
-
-		// Pack MSB 8 bits of each pixel
-		dst[0] = (p0 >> 2) & 0xFF;
-		dst[1] = (p1 >> 2) & 0xFF;
-		dst[2] = (p2 >> 2) & 0xFF;
-		dst[3] = (p3 >> 2) & 0xFF;
-
-		// Pack LSB 2 bits of each pixel into 5th byte
-		dst[4] = ((p0 & 0x03) << 6) |
-			 ((p1 & 0x03) << 4) |
-			 ((p2 & 0x03) << 2) |
-			 ((p3 & 0x03) << 0);
-	}
+	static_assert(Packer::pixels_per_group == Layout::pixels_per_group);
+	static_assert(Packer::bytes_per_group == Layout::bytes_per_group);
 
-	// Pack 12-bit pixels: 2 pixels (24 bits) into 3 bytes
-	static void pack_12bit_group(uint8_t* dst, const std::array<uint16_t, 2>& values)
+	// The RGB16 channels of the even and of the odd pixels of row y
+	static constexpr std::array<int, 2> get_row_channels(size_t y)
 	{
-		// Convert from 16-bit to 12-bit values
-		const uint16_t p0 = values[0] >> 4;
-		const uint16_t p1 = values[1] >> 4;
-
-		// Pack MSB 8 bits of each pixel
-		dst[0] = (p0 >> 4) & 0xFF;
-		dst[1] = (p1 >> 4) & 0xFF;
-
-		// Pack LSB 4 bits of each pixel into 3rd byte
-		dst[2] = ((p0 & 0x0F) << 4) |
-			 ((p1 & 0x0F) << 0);
+		return { pixel_channel<RGB16>(get_bayer_component(0, y)),
+			 pixel_channel<RGB16>(get_bayer_component(1, y)) };
 	}
 
 public:
-	static void pack_line(HasIndexOperatorReturning<TStorage> auto&& dst_line,
-			      HasIndexOperatorReturning<RGB16> auto&& src_line,
-			      size_t num_pixels, size_t y)
+	static void pack_line(uint8_t* dst, const RGB16* src, size_t num_pixels, size_t y)
 	{
-		if constexpr (bit_depth == 10) {
-			// Process 4 pixels at a time for 10-bit packed
-			for (size_t x = 0; x < num_pixels; x += pixels_per_group) {
-				std::array<uint16_t, 4> pixel_values;
-
-				for (size_t i = 0; i < pixels_per_group && (x + i) < num_pixels; i++) {
-					const RGB16& pix = src_line[x + i];
-					const ComponentType component = get_bayer_component(x + i, y);
-					pixel_values[i] = extract_component(pix, component);
-				}
-
-				// Fill remaining pixels with 0 if at end of line
-				for (size_t i = num_pixels - x; i < pixels_per_group; i++) {
-					pixel_values[i] = 0;
-				}
-
-				const size_t group_idx = x / pixels_per_group;
-				uint8_t* dst_bytes = reinterpret_cast<uint8_t*>(&dst_line[0]);
-				pack_10bit_group(dst_bytes + group_idx * bytes_per_group, pixel_values);
-			}
-		} else if constexpr (bit_depth == 12) {
-			// Process 2 pixels at a time for 12-bit packed
-			for (size_t x = 0; x < num_pixels; x += pixels_per_group) {
-				std::array<uint16_t, 2> pixel_values;
-
-				for (size_t i = 0; i < pixels_per_group && (x + i) < num_pixels; i++) {
-					const RGB16& pix = src_line[x + i];
-					const ComponentType component = get_bayer_component(x + i, y);
-					pixel_values[i] = extract_component(pix, component);
-				}
-
-				// Fill remaining pixels with 0 if at end of line
-				for (size_t i = num_pixels - x; i < pixels_per_group; i++) {
-					pixel_values[i] = 0;
-				}
-
-				const size_t group_idx = x / pixels_per_group;
-				uint8_t* dst_bytes = reinterpret_cast<uint8_t*>(&dst_line[0]);
-				pack_12bit_group(dst_bytes + group_idx * bytes_per_group, pixel_values);
-			}
-		}
+		const auto [ch0, ch1] = get_row_channels(y);
+
+		Packer::pack(dst, src, num_pixels, ch0, ch1);
 	}
 
 	static void write_pattern(IFramebuffer& fb, size_t start_y, size_t end_y,
@@ -210,19 +136,41 @@ public:
 	{
 		std::vector<RGB16> linebuf(fb.width());
 
-		// For packed formats, the stride represents bytes per line
-		// We need to calculate the correct width in bytes for the view
-		const size_t bytes_per_line = fb.stride(0);
-
-		auto view = make_strided_fb_view<TStorage>(fb.map(0), fb.height(),
-							   bytes_per_line, fb.stride(0));
+		RowMemo<1, 2> memo(fb);
 
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
+
 			generate_line(y_src, linebuf);
 
-			auto dst = md::submdspan(view, y_src, md::full_extent);
+			pack_line(fb.map(0) + y_src * fb.stride(0), linebuf.data(), fb.width(), y_src);
+		}
+	}
+};
+
+template<typename Layout>
+class BayerPacked_Reader
+{
+	using Writer = BayerPacked_Writer<Layout>;
+
+	using Packer = typename Writer::Packer;
+
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0.
+	// There's no demosaicing: a pixel gets the color component of its Bayer site,
+	// and the other components are 0.
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<RGB16> auto&& dest)
+	{
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
+
+		for (size_t y = start_y; y <= end_y; y++) {
+			const auto [ch0, ch1] = Writer::get_row_channels(y);
 
-			pack_line(dst, linebuf, fb.width(), y_src);
+			Packer::unpack(&dest(y - start_y, 0), fb.map(0) + y * fb.stride(0), fb.width(),
+				       ch0, ch1);
 		}
 	}
 };
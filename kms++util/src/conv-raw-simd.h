@@ -0,0 +1,408 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include <kms++util/color16.h>
+
+#include "conv-simd.h"
+
+namespace kms
+{
+
+/*
+ * MIPI CSI-2 packed Bayer line kernels
+ *
+ * BayerLinePacker packs the Bayer samples of a line of RGB16 pixels to the CSI-2
+ * 10-bit (4 pixels in 5 bytes) or 12-bit (2 pixels in 3 bytes) packing, and
+ * unpacks them back. The caller resolves the Bayer phase of the row to the RGB16
+ * channels of the even and of the odd pixels, so the kernels don't depend on the
+ * Bayer order.
+ *
+ * The SSE4.1 and NEON variants handle 8 pixels per step, as long as a 16 byte
+ * load or store stays within the line. The scalar kernel handles the rest. The
+ * SSE4.1 variant is picked at runtime, as with the line packers.
+ */
+
+template<size_t BitDepth>
+class BayerLinePacker
+{
+	static_assert(BitDepth == 10 || BitDepth == 12);
+
+public:
+	static constexpr size_t pixels_per_group = BitDepth == 10 ? 4 : 2;
+	static constexpr size_t bytes_per_group = BitDepth == 10 ? 5 : 3;
+
+	// Pack channel ch0 of the even pixels and channel ch1 of the odd pixels. A
+	// partial last group is padded with zeros.
+	static void pack(uint8_t* dst, const RGB16* src, size_t num_pixels, int ch0, int ch1)
+	{
+		size_t done = pack_simd(dst, src, num_pixels, ch0, ch1);
+
+		pack_scalar(dst + done / pixels_per_group * bytes_per_group, src + done,
+			    num_pixels - done, ch0, ch1);
+	}
+
+	// Unpack to channel ch0 of the even pixels and channel ch1 of the odd pixels.
+	// The other color channels are set to 0 and alpha to opaque.
+	static void unpack(RGB16* dst, const uint8_t* src, size_t num_pixels, int ch0, int ch1)
+	{
+		size_t done = unpack_simd(dst, src, num_pixels, ch0, ch1);
+
+		unpack_scalar(dst + done, src + done / pixels_per_group * bytes_per_group,
+			      num_pixels - done, ch0, ch1);
+	}
+
+private:
+	using Group = std::array<uint16_t, pixels_per_group>;
+
+	static constexpr size_t low_bits = BitDepth - 8;
+
+	// Byte of the packed data holding the high 8 bits of pixel i
+	static constexpr size_t high_byte(size_t i)
+	{
+		return i / pixels_per_group * bytes_per_group + i % pixels_per_group;
+	}
+
+	// Byte of the packed data holding the low bits of pixel i
+	static constexpr size_t low_byte(size_t i)
+	{
+		return i / pixels_per_group * bytes_per_group + pixels_per_group;
+	}
+
+	// Position of the low bits of pixel i in their byte
+	static constexpr size_t low_shift(size_t i)
+	{
+		return (pixels_per_group - 1 - i % pixels_per_group) * low_bits;
+	}
+
+	// Whether the next 8 pixels can be handled with a 16 byte load or store of
+	// packed data, without going past the whole groups of the line
+	static constexpr bool simd_fits(size_t num_pixels)
+	{
+		return num_pixels >= 8 && num_pixels / pixels_per_group * bytes_per_group >= 16;
+	}
+
+	static uint16_t get_channel(const RGB16& pix, int ch)
+	{
+		switch (ch) {
+		case 0: return pix.r;
+		case 1: return pix.g;
+		default: return pix.b;
+		}
+	}
+
+	static RGB16 make_pixel(int ch, uint16_t value)
+	{
+		switch (ch) {
+		case 0: return RGB16(value, 0, 0);
+		case 1: return RGB16(0, value, 0);
+		default: return RGB16(0, 0, value);
+		}
+	}
+
+	// Pack the top-aligned 16 bit values of a group
+	static void pack_group(uint8_t* dst, const Group& values)
+	{
+		uint8_t low = 0;
+
+		for (size_t i = 0; i < pixels_per_group; i++) {
+			dst[i] = values[i] >> 8;
+			low |= ((values[i] >> (16 - BitDepth)) & ((1 << low_bits) - 1)) << low_shift(i);
+		}
+
+		dst[pixels_per_group] = low;
+	}
+
+	// Unpack a group to top-aligned 16 bit values
+	static Group unpack_group(const uint8_t* src)
+	{
+		Group values;
+
+		for (size_t i = 0; i < pixels_per_group; i++) {
+			const uint16_t low = (src[pixels_per_group] >> low_shift(i)) & ((1 << low_bits) - 1);
+			values[i] = (src[i] << 8) | (low << (16 - BitDepth));
+		}
+
+		return values;
+	}
+
+	static void pack_scalar(uint8_t* dst, const RGB16* src, size_t num_pixels, int ch0, int ch1)
+	{
+		for (size_t x = 0; x < num_pixels; x += pixels_per_group) {
+			Group values {};
+
+			for (size_t i = 0; i < pixels_per_group && x + i < num_pixels; i++)
+				values[i] = get_channel(src[x + i], i % 2 ? ch1 : ch0);
+
+			pack_group(dst + x / pixels_per_group * bytes_per_group, values);
+		}
+	}
+
+	static void unpack_scalar(RGB16* dst, const uint8_t* src, size_t num_pixels, int ch0, int ch1)
+	{
+		for (size_t x = 0; x < num_pixels; x += pixels_per_group) {
+			const Group values = unpack_group(src + x / pixels_per_group * bytes_per_group);
+
+			for (size_t i = 0; i < pixels_per_group && x + i < num_pixels; i++)
+				dst[x + i] = make_pixel(i % 2 ? ch1 : ch0, values[i]);
+		}
+	}
+
+	// Byte shuffle from the high bytes of 8 pixels, followed by the low bytes of
+	// their groups every low_stride bytes, to the packed layout
+	static constexpr std::array<uint8_t, 16> pack_shuffle(size_t low_stride)
+	{
+		std::array<uint8_t, 16> idx {};
+
+		for (size_t i = 0; i < 8; i++) {
+			idx[high_byte(i)] = i;
+			idx[low_byte(i)] = 8 + i / pixels_per_group * low_stride;
+		}
+
+		return idx;
+	}
+
+	// Returns the number of pixels packed
+	static size_t pack_simd([[maybe_unused]] uint8_t* dst, [[maybe_unused]] const RGB16* src,
+				[[maybe_unused]] size_t num_pixels, [[maybe_unused]] int ch0,
+				[[maybe_unused]] int ch1)
+	{
+#if defined(__ARM_NEON)
+		return pack_neon(dst, src, num_pixels, ch0, ch1);
+#elif defined(KMSXX_X86_SIMD)
+		if (x86_simd_level() != X86SimdLevel::None)
+			return pack_sse(dst, src, num_pixels, ch0, ch1);
+#endif
+		return 0;
+	}
+
+	// Returns the number of pixels unpacked
+	static size_t unpack_simd([[maybe_unused]] RGB16* dst, [[maybe_unused]] const uint8_t* src,
+				  [[maybe_unused]] size_t num_pixels, [[maybe_unused]] int ch0,
+				  [[maybe_unused]] int ch1)
+	{
+#if defined(__ARM_NEON)
+		return unpack_neon(dst, src, num_pixels, ch0, ch1);
+#elif defined(KMSXX_X86_SIMD)
+		if (x86_simd_level() != X86SimdLevel::None)
+			return unpack_sse(dst, src, num_pixels, ch0, ch1);
+#endif
+		return 0;
+	}
+
+#if defined(KMSXX_X86_SIMD)
+	__attribute__((target("sse4.1"))) static __m128i load_bytes(
+		const std::array<uint8_t, 16>& bytes)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data()));
+	}
+
+	__attribute__((target("sse4.1"))) static size_t pack_sse(uint8_t* dst, const RGB16* src,
+								 size_t num_pixels, int ch0, int ch1)
+	{
+		static constexpr std::array<uint8_t, 16> out_shuffle = pack_shuffle(1);
+
+		// Gather the samples of the two pixels of a register to its low 32 bits
+		std::array<uint8_t, 16> sample_bytes;
+		sample_bytes.fill(0x80);
+		sample_bytes[0] = ch0 * 2;
+		sample_bytes[1] = ch0 * 2 + 1;
+		sample_bytes[2] = 8 + ch1 * 2;
+		sample_bytes[3] = 8 + ch1 * 2 + 1;
+
+		const __m128i sample_shuf = load_bytes(sample_bytes);
+		const __m128i out_shuf = load_bytes(out_shuffle);
+		const __m128i low_mask = _mm_set1_epi16((1 << low_bits) - 1);
+		const __m128i low_mul = _mm_setr_epi16(1 << low_shift(0), 1 << low_shift(1),
+						       1 << low_shift(2), 1 << low_shift(3),
+						       1 << low_shift(4), 1 << low_shift(5),
+						       1 << low_shift(6), 1 << low_shift(7));
+
+		size_t x = 0;
+
+		for (; simd_fits(num_pixels - x); x += 8) {
+			const __m128i* p = reinterpret_cast<const __m128i*>(src + x);
+
+			__m128i s0 = _mm_shuffle_epi8(_mm_loadu_si128(p + 0), sample_shuf);
+			__m128i s1 = _mm_shuffle_epi8(_mm_loadu_si128(p + 1), sample_shuf);
+			__m128i s2 = _mm_shuffle_epi8(_mm_loadu_si128(p + 2), sample_shuf);
+			__m128i s3 = _mm_shuffle_epi8(_mm_loadu_si128(p + 3), sample_shuf);
+
+			const __m128i v = _mm_unpacklo_epi64(_mm_unpacklo_epi32(s0, s1),
+							     _mm_unpacklo_epi32(s2, s3));
+
+			const __m128i high = _mm_srli_epi16(v, 8);
+
+			// Shift the low bits of each pixel to their place in the low byte
+			// of the group, and sum them per group
+			__m128i low = _mm_and_si128(_mm_srli_epi16(v, 16 - BitDepth), low_mask);
+			low = _mm_madd_epi16(_mm_mullo_epi16(low, low_mul), _mm_set1_epi16(1));
+			if constexpr (pixels_per_group == 4)
+				low = _mm_hadd_epi32(low, low);
+
+			__m128i bytes = _mm_packus_epi16(high, _mm_packus_epi32(low, low));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x / pixels_per_group * bytes_per_group),
+					 _mm_shuffle_epi8(bytes, out_shuf));
+		}
+
+		return x;
+	}
+
+	__attribute__((target("sse4.1"))) static size_t unpack_sse(RGB16* dst, const uint8_t* src,
+								   size_t num_pixels, int ch0, int ch1)
+	{
+		static constexpr auto shuffles = [] {
+			std::array<std::array<uint8_t, 16>, 2> s {};
+
+			for (size_t i = 0; i < 8; i++) {
+				s[0][i * 2] = 0x80;
+				s[0][i * 2 + 1] = high_byte(i);
+				s[1][i * 2] = low_byte(i);
+				s[1][i * 2 + 1] = 0x80;
+			}
+
+			return s;
+		}();
+
+		// Spread the two values in the low 32 bits to the channels of two pixels
+		std::array<uint8_t, 16> pixel_bytes;
+		pixel_bytes.fill(0x80);
+		pixel_bytes[ch0 * 2] = 0;
+		pixel_bytes[ch0 * 2 + 1] = 1;
+		pixel_bytes[8 + ch1 * 2] = 2;
+		pixel_bytes[8 + ch1 * 2 + 1] = 3;
+
+		const __m128i high_shuf = load_bytes(shuffles[0]);
+		const __m128i low_shuf = load_bytes(shuffles[1]);
+		const __m128i pixel_shuf = load_bytes(pixel_bytes);
+		const __m128i low_mask = _mm_set1_epi16(((1 << low_bits) - 1) << (16 - BitDepth));
+		const __m128i low_mul = _mm_setr_epi16(1 << (16 - BitDepth - low_shift(0)),
+						       1 << (16 - BitDepth - low_shift(1)),
+						       1 << (16 - BitDepth - low_shift(2)),
+						       1 << (16 - BitDepth - low_shift(3)),
+						       1 << (16 - BitDepth - low_shift(4)),
+						       1 << (16 - BitDepth - low_shift(5)),
+						       1 << (16 - BitDepth - low_shift(6)),
+						       1 << (16 - BitDepth - low_shift(7)));
+		const __m128i alpha = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+
+		size_t x = 0;
+
+		for (; simd_fits(num_pixels - x); x += 8) {
+			const __m128i in = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(src + x / pixels_per_group * bytes_per_group));
+
+			__m128i low = _mm_mullo_epi16(_mm_shuffle_epi8(in, low_shuf), low_mul);
+			const __m128i v = _mm_or_si128(_mm_shuffle_epi8(in, high_shuf),
+						       _mm_and_si128(low, low_mask));
+
+			__m128i* p = reinterpret_cast<__m128i*>(dst + x);
+
+			_mm_storeu_si128(p + 0, _mm_or_si128(_mm_shuffle_epi8(v, pixel_shuf), alpha));
+			_mm_storeu_si128(p + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(v, 4), pixel_shuf), alpha));
+			_mm_storeu_si128(p + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(v, 8), pixel_shuf), alpha));
+			_mm_storeu_si128(p + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(v, 12), pixel_shuf), alpha));
+		}
+
+		return x;
+	}
+#endif
+
+#if defined(__ARM_NEON)
+	static int16x8_t load_shifts(int base, bool negate)
+	{
+		int16_t s[8];
+
+		for (size_t i = 0; i < 8; i++)
+			s[i] = negate ? base - low_shift(i) : low_shift(i);
+
+		return vld1q_s16(s);
+	}
+
+	static size_t pack_neon(uint8_t* dst, const RGB16* src, size_t num_pixels, int ch0, int ch1)
+	{
+		// The low bytes of the groups end up every 4 bytes for 10-bit packing,
+		// and every 2 bytes for 12-bit packing
+		static constexpr std::array<uint8_t, 16> out_shuffle =
+			pack_shuffle(pixels_per_group == 4 ? 4 : 2);
+
+		const uint8x8_t out_lo = vld1_u8(out_shuffle.data());
+		const uint8x8_t out_hi = vld1_u8(out_shuffle.data() + 8);
+		const uint16x8_t even = vreinterpretq_u16_u32(vdupq_n_u32(0xffff));
+		const uint16x8_t low_mask = vdupq_n_u16((1 << low_bits) - 1);
+		const int16x8_t shifts = load_shifts(0, false);
+
+		size_t x = 0;
+
+		for (; simd_fits(num_pixels - x); x += 8) {
+			const uint16x8x4_t pix = vld4q_u16(reinterpret_cast<const uint16_t*>(src + x));
+			const uint16x8_t v = vbslq_u16(even, pix.val[ch0], pix.val[ch1]);
+
+			uint16x8_t low = vandq_u16(vshrq_n_u16(v, 16 - BitDepth), low_mask);
+			uint32x4_t sums = vpaddlq_u16(vshlq_u16(low, shifts));
+
+			uint8x8_t low_bytes;
+			if constexpr (pixels_per_group == 4)
+				low_bytes = vreinterpret_u8_u32(vpaddl_u16(vmovn_u32(sums)));
+			else
+				low_bytes = vreinterpret_u8_u16(vmovn_u32(sums));
+
+			const uint8x8x2_t table = { { vshrn_n_u16(v, 8), low_bytes } };
+
+			vst1q_u8(dst + x / pixels_per_group * bytes_per_group,
+				 vcombine_u8(vtbl2_u8(table, out_lo), vtbl2_u8(table, out_hi)));
+		}
+
+		return x;
+	}
+
+	static size_t unpack_neon(RGB16* dst, const uint8_t* src, size_t num_pixels, int ch0, int ch1)
+	{
+		static constexpr auto indices = [] {
+			std::array<std::array<uint8_t, 8>, 2> s {};
+
+			for (size_t i = 0; i < 8; i++) {
+				s[0][i] = high_byte(i);
+				s[1][i] = low_byte(i);
+			}
+
+			return s;
+		}();
+
+		const uint8x8_t high_idx = vld1_u8(indices[0].data());
+		const uint8x8_t low_idx = vld1_u8(indices[1].data());
+		const uint16x8_t even = vreinterpretq_u16_u32(vdupq_n_u32(0xffff));
+		const uint16x8_t low_mask = vdupq_n_u16(((1 << low_bits) - 1) << (16 - BitDepth));
+		const int16x8_t shifts = load_shifts(16 - BitDepth, true);
+
+		uint16x8x4_t pix;
+		pix.val[0] = vdupq_n_u16(0);
+		pix.val[1] = vdupq_n_u16(0);
+		pix.val[2] = vdupq_n_u16(0);
+		pix.val[3] = vdupq_n_u16(RGB16::max_value);
+
+		size_t x = 0;
+
+		for (; simd_fits(num_pixels - x); x += 8) {
+			const uint8x16_t in = vld1q_u8(src + x / pixels_per_group * bytes_per_group);
+			const uint8x8x2_t table = { { vget_low_u8(in), vget_high_u8(in) } };
+
+			const uint16x8_t low = vshlq_u16(vmovl_u8(vtbl2_u8(table, low_idx)), shifts);
+			const uint16x8_t v = vorrq_u16(vshll_n_u8(vtbl2_u8(table, high_idx), 8),
+						       vandq_u16(low, low_mask));
+
+			pix.val[ch0] = vandq_u16(v, even);
+			pix.val[ch1] = vbicq_u16(v, even);
+
+			vst4q_u16(reinterpret_cast<uint16_t*>(dst + x), pix);
+		}
+
+		return x;
+	}
+#endif
+};
+
+} // namespace kms
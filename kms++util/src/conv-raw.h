@@ -6,6 +6,8 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-line8.h"
+#include "conv-rowmemo.h"
 
 namespace kms
 {
@@ -93,9 +95,14 @@ using SGBRG16_Layout = Bayer16_Layout<BayerOrder::GBRG>;
 using SGRBG16_Layout = Bayer16_Layout<BayerOrder::GRBG>;
 using SBGGR16_Layout = Bayer16_Layout<BayerOrder::BGGR>;
 
+template<typename Layout>
+class Bayer_Reader;
+
 template<typename Layout>
 class Bayer_Writer
 {
+	friend class Bayer_Reader<Layout>;
+
 	using Plane = typename Layout::template plane<0>;
 	using TStorage = typename Plane::storage_type;
 
@@ -184,12 +191,22 @@ public:
 	static void write_pattern(IFramebuffer& fb, size_t start_y, size_t end_y,
 				  auto&& generate_line)
 	{
+		if constexpr (is_8bit_layout<Layout>) {
+			write_pattern_8bit(fb, start_y, end_y, generate_line);
+			return;
+		}
+
 		std::vector<RGB16> linebuf(fb.width());
 
 		auto view = make_strided_fb_view<TStorage>(fb.map(0), fb.height(), fb.width(),
 							   fb.stride(0));
 
+		RowMemo<1, 2> memo(fb);
+
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
+
 			generate_line(y_src, linebuf);
 
 			auto dst = md::submdspan(view, y_src, md::full_extent);
@@ -197,6 +214,93 @@ public:
 			pack_line(dst, linebuf, fb.width(), y_src);
 		}
 	}
+
+private:
+	static void write_pattern_8bit(IFramebuffer& fb, size_t start_y, size_t end_y,
+				       auto&& generate_line)
+	{
+		SpanLine<RGB16> line(fb.width());
+
+		RowMemo<1, 2> memo(fb);
+
+		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
+
+			line.generate(y_src, generate_line);
+
+			uint8_t* dst = fb.map(0) + y_src * fb.stride(0);
+
+			// Each pixel pair has both sites of the row
+			auto pack_pair = [y_src](const auto& pixels, uint8_t* unit) {
+				unit[0] = extract_component(pixels[0][0], get_bayer_component(0, y_src)) >> 8;
+				unit[1] = extract_component(pixels[0][1], get_bayer_component(1, y_src)) >> 8;
+			};
+
+			pack_span_groups<2, 2>(std::array { &std::as_const(line) }, fb.width() / 2, dst,
+					       pack_pair);
+
+			if (fb.width() % 2) {
+				const size_t x = fb.width() - 1;
+
+				dst[x] = extract_component(line.pixel(x), get_bayer_component(x, y_src)) >> 8;
+			}
+		}
+	}
+};
+
+// Sets the component of pix, if it's one of R, G or B
+inline void set_bayer_component(RGB16& pix, ComponentType component, uint16_t value)
+{
+	switch (component) {
+	case ComponentType::R:
+		pix.r = value;
+		break;
+	case ComponentType::G:
+		pix.g = value;
+		break;
+	case ComponentType::B:
+		pix.b = value;
+		break;
+	default:
+		break;
+	}
+}
+
+template<typename Layout>
+class Bayer_Reader
+{
+	using Writer = Bayer_Writer<Layout>;
+	using Plane = typename Layout::template plane<0>;
+	using TStorage = typename Plane::storage_type;
+
+	static constexpr size_t y_idx = Plane::template find_pos<ComponentType::Y>();
+	static constexpr size_t y_shift = 16 - Plane::template component_size<y_idx>;
+
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0.
+	// There's no demosaicing: a pixel gets the color component of its Bayer site,
+	// and the other components are 0.
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<RGB16> auto&& dest)
+	{
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
+
+		for (size_t y = start_y; y <= end_y; y++) {
+			auto dst = md::submdspan(dest, y - start_y, md::full_extent);
+			auto src = reinterpret_cast<const TStorage*>(fb.map(0) + y * fb.stride(0));
+
+			for (size_t x = 0; x < fb.width(); x++) {
+				RGB16 pix(0, 0, 0);
+
+				set_bayer_component(pix, Writer::get_bayer_component(x, y),
+						    Plane::unpack(src[x])[y_idx] << y_shift);
+
+				dst[x] = pix;
+			}
+		}
+	}
 };
 
 } // namespace kms
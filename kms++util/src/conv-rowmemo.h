@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <kms++/framebuffer.h>
+#include <kms++/pixelformats.h>
+
+namespace kms
+{
+
+/*
+ * Row memoization
+ *
+ * A line generator may have a row_key(y) method, returning a row equivalence
+ * key. Rows with the same key, other than unique_row_key, produce identical
+ * lines.
+ *
+ * The writers draw the rows in units of unit_rows rows (the vertical
+ * subsampling). A unit whose rows all have the same key as the rows of the
+ * unit 'period' units above it is copied instead of being generated and packed
+ * again. The period is 2 for formats where the packing depends on the row
+ * parity, e.g. Bayer.
+ *
+ * Reading a framebuffer mapping can be very slow, e.g. for dumb buffers, so the
+ * first time a unit is repeated it is saved to a cached buffer, and the repeats
+ * are copied from there.
+ */
+
+constexpr uint64_t unique_row_key = UINT64_MAX;
+
+template<typename TGenerator>
+constexpr bool has_row_key = requires(const TGenerator& gen) {
+	{ gen.row_key(size_t(0)) } -> std::convertible_to<uint64_t>;
+};
+
+template<size_t unit_rows, size_t period = 1>
+class RowMemo
+{
+public:
+	RowMemo(IFramebuffer& fb)
+		: m_fb(fb)
+	{
+		const auto& info = get_pixel_format_info(fb.format());
+
+		for (size_t p = 0; p < fb.num_planes(); ++p)
+			m_plane_vsub[p] = info.planes[p].vsub;
+
+		m_keys.fill(unique_row_key);
+		m_saved_keys.fill(unique_row_key);
+	}
+
+	// Copy the unit starting at row y if it's identical to an already drawn unit.
+	// Returns false if the unit has to be drawn.
+	bool copy_unit(size_t y, const auto& generate_line)
+	{
+		if constexpr (!has_row_key<std::remove_cvref_t<decltype(generate_line)>>) {
+			return false;
+		} else {
+			uint64_t key = generate_line.row_key(y);
+
+			for (size_t i = 1; i < unit_rows && key != unique_row_key; ++i) {
+				if (generate_line.row_key(y + i) != key)
+					key = unique_row_key;
+			}
+
+			// The slot holds the key of the unit 'period' units above
+			uint64_t& prev_key = m_keys[(y / unit_rows) % period];
+
+			bool copy = key != unique_row_key && prev_key == key;
+
+			prev_key = key;
+
+			if (copy)
+				copy_rows((y / unit_rows) % period, key, y - period * unit_rows, y);
+
+			return copy;
+		}
+	}
+
+private:
+	void copy_rows(size_t slot, uint64_t key, size_t src_y, size_t dst_y)
+	{
+		std::vector<uint8_t>& saved = m_saved[slot];
+
+		if (m_saved_keys[slot] != key) {
+			size_t size = 0;
+
+			for (size_t p = 0; p < m_fb.num_planes(); ++p)
+				size += unit_rows / m_plane_vsub[p] * m_fb.stride(p);
+
+			saved.resize(size);
+
+			uint8_t* dst = saved.data();
+
+			for (size_t p = 0; p < m_fb.num_planes(); ++p) {
+				const size_t vsub = m_plane_vsub[p];
+				const size_t stride = m_fb.stride(p);
+
+				memcpy(dst, m_fb.map(p) + src_y / vsub * stride, unit_rows / vsub * stride);
+				dst += unit_rows / vsub * stride;
+			}
+
+			m_saved_keys[slot] = key;
+		}
+
+		const uint8_t* src = saved.data();
+
+		for (size_t p = 0; p < m_fb.num_planes(); ++p) {
+			const size_t vsub = m_plane_vsub[p];
+			const size_t stride = m_fb.stride(p);
+
+			memcpy(m_fb.map(p) + dst_y / vsub * stride, src, unit_rows / vsub * stride);
+			src += unit_rows / vsub * stride;
+		}
+	}
+
+	IFramebuffer& m_fb;
+	std::array<size_t, 4> m_plane_vsub {};
+	std::array<uint64_t, period> m_keys;
+
+	// The units saved for copying, by the slot of m_keys, and their keys
+	std::array<std::vector<uint8_t>, period> m_saved;
+	std::array<uint64_t, period> m_saved_keys;
+};
+
+} // namespace kms
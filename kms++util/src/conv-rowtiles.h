@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <kms++/framebuffer.h>
+#include <kms++/pixelformats.h>
+#include <kms++util/threadpool.h>
+
+namespace kms
+{
+
+/*
+ * Row tiles
+ *
+ * Framebuffers are processed in parallel in tiles of whole rows, aligned to the
+ * vertical subsampling of the format, on the shared thread pool.
+ */
+
+// Aim for tiles of about 64 KiB, so that a tile stays in the cache while it is being
+// written, but make at least a few tiles per thread to balance the load. Patterns made
+// of bands of identical rows are mostly copied row by row, and a tile only packs its
+// first row of each band, so for them the tiles are made as large as possible.
+inline size_t get_tile_height(const IFramebuffer& fb, const PixelFormatInfo& info,
+			      size_t num_rows, size_t v_sub, size_t num_threads, bool row_bands)
+{
+	const size_t tile_bytes = 64 * 1024;
+	const size_t min_tiles_per_thread = 4;
+
+	size_t row_bytes = 0;
+	for (size_t p = 0; p < fb.num_planes(); ++p)
+		row_bytes += fb.stride(p) / info.planes[p].vsub;
+
+	size_t height = num_rows / (num_threads * min_tiles_per_thread);
+
+	if (!row_bands)
+		height = std::min(height, tile_bytes / std::max(row_bytes, (size_t)1));
+
+	// round down to v_sub, but keep at least one v_sub block
+	return std::max(height / v_sub * v_sub, v_sub);
+}
+
+// The largest vertical subsampling of the format's planes
+inline size_t get_max_vsub(PixelFormat format)
+{
+	const auto& info = get_pixel_format_info(format);
+	size_t v_sub = 0;
+	for (size_t p = 0; p < info.num_planes; ++p)
+		v_sub = std::max(v_sub, (size_t)info.planes[p].vsub);
+
+	return v_sub;
+}
+
+// Run func(tile_start_y, tile_end_y) for row tiles of the rows start_y...end_y. The
+// tiles are aligned to the vertical subsampling, and to row_align.
+inline void run_row_tiles(IFramebuffer& fb, size_t start_y, size_t end_y, unsigned num_threads,
+			  const std::vector<unsigned>& cpus, bool row_bands,
+			  const std::function<void(size_t start_y, size_t end_y)>& func,
+			  size_t row_align = 1)
+{
+	const auto& info = get_pixel_format_info(fb.format());
+	size_t v_sub = get_max_vsub(fb.format());
+
+	if (!v_sub || fb.height() % v_sub)
+		throw std::invalid_argument("FB height must be divisible with vsub");
+
+	v_sub = std::lcm(v_sub, row_align);
+
+	if (start_y > end_y || end_y >= fb.height() || start_y % v_sub || (end_y + 1) % v_sub)
+		throw std::invalid_argument("Rows must be within the FB and aligned to vsub");
+
+	// Create the mmaps before starting the threads
+	for (size_t i = 0; i < fb.num_planes(); ++i)
+		fb.map(i);
+
+	auto pool = ThreadPool::get_shared(num_threads, cpus);
+
+	const size_t num_rows = end_y - start_y + 1;
+	size_t tile_height = get_tile_height(fb, info, num_rows, v_sub, pool->num_threads(),
+					     row_bands);
+	size_t num_tiles = (num_rows + tile_height - 1) / tile_height;
+
+	pool->run(num_tiles, [&func, start_y, end_y, tile_height](size_t tile) {
+		size_t start = start_y + tile * tile_height;
+		size_t end = std::min(start + tile_height - 1, end_y);
+
+		func(start, end);
+	});
+}
+
+} // namespace kms
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <kms++util/kms++util.h>
+
+#include "conv-simd.h"
+
+namespace kms
+{
+
+/*
+ * Scaling
+ *
+ * The scaler is separable: the source rows are first scaled horizontally, and the
+ * horizontally scaled rows are then combined vertically. Both passes work on lines
+ * of four channel 16-bit pixels (RGB16 or YUV16), with fixed point coefficient
+ * tables holding the taps of each output position.
+ *
+ * The filters are widened by the downscaling ratio, so that all source pixels
+ * contribute to the output. Taps outside the source are folded onto the edge
+ * pixels.
+ *
+ * The tap loops have SSE4.1, AVX2 and NEON variants, and a scalar fallback. As
+ * with the line packers, the x86 variants are picked at runtime by what the CPU
+ * supports, and NEON is enabled by the compiler's target flags.
+ */
+
+class ScaleTable
+{
+public:
+	static constexpr int frac_bits = 14;
+	static constexpr int32_t one = 1 << frac_bits;
+
+	ScaleTable(size_t src_size, size_t dst_size, ScaleFilter filter)
+	{
+		const double scale = (double)src_size / dst_size;
+		const double filter_scale = std::max(scale, 1.0);
+		const double radius = filter == ScaleFilter::Bilinear ? 1.0 : 2.0;
+		const double support = radius * filter_scale;
+
+		const size_t full_taps = (size_t)std::ceil(support * 2);
+
+		m_taps = std::min(full_taps, src_size);
+		m_start.resize(dst_size);
+		m_coefs.resize(dst_size * m_taps);
+
+		std::vector<double> weights(full_taps);
+		std::vector<int32_t> quantized(full_taps);
+
+		for (size_t i = 0; i < dst_size; i++) {
+			// Center of the output pixel in source pixel coordinates
+			const double center = (i + 0.5) * scale - 0.5;
+			const ptrdiff_t first = (ptrdiff_t)std::floor(center - support) + 1;
+
+			double sum = 0;
+			for (size_t k = 0; k < full_taps; k++) {
+				weights[k] = kernel(filter, (first + (ptrdiff_t)k - center) / filter_scale);
+				sum += weights[k];
+			}
+
+			// Quantize the normalized weights, and give the rounding error to the
+			// largest tap so that the taps sum to one exactly
+			int32_t qsum = 0;
+			size_t largest = 0;
+			for (size_t k = 0; k < full_taps; k++) {
+				quantized[k] = (int32_t)std::lround(weights[k] / sum * one);
+				qsum += quantized[k];
+				if (quantized[k] > quantized[largest])
+					largest = k;
+			}
+			quantized[largest] += one - qsum;
+
+			const ptrdiff_t start = std::clamp(first, (ptrdiff_t)0,
+							   (ptrdiff_t)(src_size - m_taps));
+			int16_t* coefs = &m_coefs[i * m_taps];
+
+			for (size_t k = 0; k < full_taps; k++) {
+				ptrdiff_t j = std::clamp(first + (ptrdiff_t)k, (ptrdiff_t)0,
+							 (ptrdiff_t)src_size - 1);
+				coefs[j - start] += quantized[k];
+			}
+
+			m_start[i] = start;
+		}
+	}
+
+	size_t taps() const { return m_taps; }
+
+	// First source pixel of the output position i
+	size_t start(size_t i) const { return m_start[i]; }
+	const int16_t* coefs(size_t i) const { return &m_coefs[i * m_taps]; }
+
+private:
+	static double kernel(ScaleFilter filter, double t)
+	{
+		t = std::abs(t);
+
+		if (filter == ScaleFilter::Bilinear)
+			return std::max(1.0 - t, 0.0);
+
+		// Catmull-Rom cubic
+		if (t < 1)
+			return 1.5 * t * t * t - 2.5 * t * t + 1;
+		if (t < 2)
+			return -0.5 * t * t * t + 2.5 * t * t - 4 * t + 2;
+		return 0;
+	}
+
+	size_t m_taps;
+	std::vector<size_t> m_start;
+	std::vector<int16_t> m_coefs;
+};
+
+#if defined(KMSXX_X86_SIMD)
+__attribute__((target("sse4.1"))) inline void scale_line_h_sse41(uint16_t* dst, const uint16_t* src,
+								 const ScaleTable& table,
+								 size_t dst_width)
+{
+	const size_t taps = table.taps();
+	constexpr int32_t round = ScaleTable::one / 2;
+
+	for (size_t x = 0; x < dst_width; x++) {
+		const uint16_t* s = src + table.start(x) * 4;
+		const int16_t* c = table.coefs(x);
+
+		__m128i acc = _mm_set1_epi32(round);
+
+		for (size_t k = 0; k < taps; k++) {
+			__m128i v = _mm_cvtepu16_epi32(
+				_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + k * 4)));
+			acc = _mm_add_epi32(acc, _mm_mullo_epi32(v, _mm_set1_epi32(c[k])));
+		}
+
+		acc = _mm_srai_epi32(acc, ScaleTable::frac_bits);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi32(acc, acc));
+	}
+}
+#endif
+
+// Scale a line of four channel pixels horizontally to dst_width pixels
+inline void scale_line_h(uint16_t* dst, const uint16_t* src, const ScaleTable& table,
+			 size_t dst_width)
+{
+	const size_t taps = table.taps();
+	constexpr int32_t round = ScaleTable::one / 2;
+
+#if defined(KMSXX_X86_SIMD)
+	if (x86_simd_level() != X86SimdLevel::None)
+		return scale_line_h_sse41(dst, src, table, dst_width);
+#endif
+
+	for (size_t x = 0; x < dst_width; x++) {
+		const uint16_t* s = src + table.start(x) * 4;
+		const int16_t* c = table.coefs(x);
+
+#if defined(__ARM_NEON)
+		int32x4_t acc = vdupq_n_s32(round);
+
+		for (size_t k = 0; k < taps; k++) {
+			int32x4_t v = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(s + k * 4)));
+			acc = vmlaq_n_s32(acc, v, c[k]);
+		}
+
+		vst1_u16(dst + x * 4, vqshrun_n_s32(acc, ScaleTable::frac_bits));
+#else
+		int32_t acc[4] = { round, round, round, round };
+
+		for (size_t k = 0; k < taps; k++) {
+			for (size_t ch = 0; ch < 4; ch++)
+				acc[ch] += c[k] * s[k * 4 + ch];
+		}
+
+		for (size_t ch = 0; ch < 4; ch++)
+			dst[x * 4 + ch] = std::clamp(acc[ch] >> ScaleTable::frac_bits, 0, 0xffff);
+#endif
+	}
+}
+
+#if defined(KMSXX_X86_SIMD)
+// Combine the values from i on, eight at a time. Returns the number of values done.
+__attribute__((target("sse4.1"))) inline size_t scale_line_v_sse41(uint16_t* dst,
+								   const uint16_t* const* rows,
+								   const int16_t* coefs,
+								   size_t num_taps,
+								   size_t num_values, size_t i)
+{
+	constexpr int32_t round = ScaleTable::one / 2;
+
+	for (; i + 8 <= num_values; i += 8) {
+		__m128i lo = _mm_set1_epi32(round);
+		__m128i hi = _mm_set1_epi32(round);
+
+		for (size_t k = 0; k < num_taps; k++) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+			__m128i c = _mm_set1_epi32(coefs[k]);
+
+			lo = _mm_add_epi32(lo, _mm_mullo_epi32(_mm_cvtepu16_epi32(v), c));
+			hi = _mm_add_epi32(hi, _mm_mullo_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)), c));
+		}
+
+		lo = _mm_srai_epi32(lo, ScaleTable::frac_bits);
+		hi = _mm_srai_epi32(hi, ScaleTable::frac_bits);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi32(lo, hi));
+	}
+
+	return i;
+}
+
+// As scale_line_v_sse41(), sixteen values at a time
+__attribute__((target("avx2"))) inline size_t scale_line_v_avx2(uint16_t* dst,
+								const uint16_t* const* rows,
+								const int16_t* coefs,
+								size_t num_taps,
+								size_t num_values)
+{
+	constexpr int32_t round = ScaleTable::one / 2;
+	size_t i = 0;
+
+	for (; i + 16 <= num_values; i += 16) {
+		__m256i lo = _mm256_set1_epi32(round);
+		__m256i hi = _mm256_set1_epi32(round);
+
+		for (size_t k = 0; k < num_taps; k++) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k] + i));
+			__m256i c = _mm256_set1_epi32(coefs[k]);
+
+			lo = _mm256_add_epi32(lo, _mm256_mullo_epi32(
+				_mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)), c));
+			hi = _mm256_add_epi32(hi, _mm256_mullo_epi32(
+				_mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)), c));
+		}
+
+		lo = _mm256_srai_epi32(lo, ScaleTable::frac_bits);
+		hi = _mm256_srai_epi32(hi, ScaleTable::frac_bits);
+
+		// packus works within the 128-bit lanes, put the quadwords back in order
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi),
+							  _MM_SHUFFLE(3, 1, 2, 0));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+	}
+
+	return scale_line_v_sse41(dst, rows, coefs, num_taps, num_values, i);
+}
+#endif
+
+// Combine num_taps rows with the coefficients into dst. Each row has num_values
+// 16-bit values.
+inline void scale_line_v(uint16_t* dst, const uint16_t* const* rows, const int16_t* coefs,
+			 size_t num_taps, size_t num_values)
+{
+	constexpr int32_t round = ScaleTable::one / 2;
+	size_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 8 <= num_values; i += 8) {
+		int32x4_t lo = vdupq_n_s32(round);
+		int32x4_t hi = vdupq_n_s32(round);
+
+		for (size_t k = 0; k < num_taps; k++) {
+			uint16x8_t v = vld1q_u16(rows[k] + i);
+			lo = vmlaq_n_s32(lo, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))), coefs[k]);
+			hi = vmlaq_n_s32(hi, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))), coefs[k]);
+		}
+
+		vst1q_u16(dst + i, vcombine_u16(vqshrun_n_s32(lo, ScaleTable::frac_bits),
+						vqshrun_n_s32(hi, ScaleTable::frac_bits)));
+	}
+#elif defined(KMSXX_X86_SIMD)
+	switch (x86_simd_level()) {
+	case X86SimdLevel::AVX2:
+		i = scale_line_v_avx2(dst, rows, coefs, num_taps, num_values);
+		break;
+	case X86SimdLevel::SSE41:
+		i = scale_line_v_sse41(dst, rows, coefs, num_taps, num_values, 0);
+		break;
+	default:
+		break;
+	}
+#endif
+
+	for (; i < num_values; i++) {
+		int32_t acc = round;
+
+		for (size_t k = 0; k < num_taps; k++)
+			acc += coefs[k] * rows[k][i];
+
+		dst[i] = std::clamp(acc >> ScaleTable::frac_bits, 0, 0xffff);
+	}
+}
+
+} // namespace kms
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KMSXX_X86_SIMD
+#endif
+
+#include <kms++util/color16.h>
+
+#include "conv-common.h"
+
+namespace kms
+{
+
+/*
+ * Line packing kernels
+ *
+ * PixelLinePacker packs a contiguous line of RGB16 or YUV16 pixels into a
+ * contiguous line of a single-plane, one-pixel-per-storage-unit layout. The
+ * kernel is picked at compile time from the layout:
+ *
+ * - 32-bit storage units (XRGB8888, ARGB2101010, XVUY2101010, ...)
+ * - 16-bit storage units (RGB565, ARGB1555, XRGB4444, Y10, ...)
+ * - 24-bit units made of whole bytes (RGB888, BGR888)
+ *
+ * Each has an SSE4.1, AVX2 and NEON variant. The x86 variants are compiled
+ * with target attributes, and picked at runtime by what the CPU supports, so
+ * they are used without any -m flags. NEON is enabled by the compiler's target
+ * flags (e.g. the aarch64 default). All other layouts, and the tail pixels of a
+ * line, use the scalar kernel.
+ */
+
+#if defined(KMSXX_X86_SIMD)
+enum class X86SimdLevel {
+	None,
+	SSE41,
+	AVX2,
+};
+
+inline X86SimdLevel x86_simd_level()
+{
+	static const X86SimdLevel level = []() {
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+			return X86SimdLevel::AVX2;
+		if (__builtin_cpu_supports("sse4.1"))
+			return X86SimdLevel::SSE41;
+		return X86SimdLevel::None;
+	}();
+
+	return level;
+}
+#endif
+
+// Channel of the source pixel holding the given component, or -1 for padding
+template<typename TPixel>
+constexpr int pixel_channel(ComponentType type)
+{
+	if constexpr (std::is_same_v<TPixel, RGB16>) {
+		switch (type) {
+		case ComponentType::R: return 0;
+		case ComponentType::G: return 1;
+		case ComponentType::B: return 2;
+		case ComponentType::A: return 3;
+		default: return -1;
+		}
+	} else {
+		static_assert(std::is_same_v<TPixel, YUV16>);
+
+		switch (type) {
+		case ComponentType::Y: return 0;
+		case ComponentType::Cb: return 1;
+		case ComponentType::Cr: return 2;
+		case ComponentType::A: return 3;
+		default: return -1;
+		}
+	}
+}
+
+enum class LineKernel {
+	Scalar,
+	Packed16,
+	Packed32,
+	Bytes24,
+};
+
+template<typename Plane, typename TPixel>
+class PixelLinePacker
+{
+	using TStorage = typename Plane::storage_type;
+
+	static constexpr size_t num_components = Plane::num_components;
+
+	static_assert(sizeof(TPixel) == 4 * sizeof(uint16_t));
+
+	template<size_t I>
+	using component = std::tuple_element_t<I, typename Plane::components_tuple>;
+
+	template<size_t I>
+	static constexpr int channel = pixel_channel<TPixel>(component<I>::type);
+
+	static constexpr bool byte_components = []<size_t... I>(std::index_sequence<I...>) {
+		return ((channel<I> >= 0 && component<I>::size == 8 &&
+			 component<I>::offset % 8 == 0) && ...);
+	}(std::make_index_sequence<num_components>{});
+
+	static constexpr LineKernel select_kernel()
+	{
+		if constexpr (Plane::storage_bits == 32 && Plane::total_bits == 32)
+			return LineKernel::Packed32;
+		else if constexpr (Plane::storage_bits == 16 && Plane::total_bits == 16)
+			return LineKernel::Packed16;
+		else if constexpr (Plane::storage_bits == 32 && Plane::total_bits == 24 &&
+				   byte_components)
+			return LineKernel::Bytes24;
+		else
+			return LineKernel::Scalar;
+	}
+
+	static uint16_t get_channel(const TPixel& pix, size_t ch)
+	{
+		uint16_t v[4];
+		memcpy(v, &pix, sizeof(v));
+		return v[ch];
+	}
+
+public:
+	static constexpr LineKernel kernel = select_kernel();
+
+	// 24-bit layouts are stored in a 32-bit unit but packed in 3 bytes
+	static constexpr size_t bytes_per_pixel =
+		Plane::total_bits == 24 ? 3 : sizeof(TStorage);
+
+	// Pack num_pixels pixels from src to dst
+	static void pack(uint8_t* dst, const TPixel* src, size_t num_pixels)
+	{
+		size_t done = pack_simd(dst, src, num_pixels);
+
+		pack_scalar(dst + done * bytes_per_pixel, src + done, num_pixels - done);
+	}
+
+	// Fill num_pixels pixels of dst with a single color. The packed color is
+	// replicated in a local buffer, so dst is only written, never read.
+	static void fill(uint8_t* dst, const TPixel& color, size_t num_pixels)
+	{
+		constexpr size_t pattern_pixels = 64;
+		uint8_t pattern[pattern_pixels * bytes_per_pixel];
+
+		const size_t n = std::min(num_pixels, pattern_pixels);
+
+		pack_scalar(pattern, &color, 1);
+		for (size_t x = 1; x < n; x++)
+			memcpy(pattern + x * bytes_per_pixel, pattern, bytes_per_pixel);
+
+		for (size_t x = 0; x < num_pixels; x += n)
+			memcpy(dst + x * bytes_per_pixel, pattern,
+			       std::min(n, num_pixels - x) * bytes_per_pixel);
+	}
+
+	static void pack_scalar(uint8_t* dst, const TPixel* src, size_t num_pixels)
+	{
+		for (size_t x = 0; x < num_pixels; x++) {
+			TStorage packed = 0;
+
+			static_for<0, num_components>([&](auto i) {
+				if constexpr (channel<i> >= 0) {
+					const uint16_t v = get_channel(src[x], channel<i>);
+					packed |= component<i>::template pack_value<TStorage>(
+						v >> (16 - component<i>::size));
+				}
+			});
+
+			memcpy(dst + x * bytes_per_pixel, &packed, bytes_per_pixel);
+		}
+	}
+
+private:
+	// Returns the number of pixels packed
+	static size_t pack_simd(uint8_t* dst, const TPixel* src, size_t num_pixels)
+	{
+#if defined(__ARM_NEON)
+		if constexpr (kernel != LineKernel::Scalar)
+			return pack_neon(dst, reinterpret_cast<const uint16_t*>(src), num_pixels);
+#elif defined(KMSXX_X86_SIMD)
+		if constexpr (kernel != LineKernel::Scalar) {
+			switch (x86_simd_level()) {
+			case X86SimdLevel::AVX2:
+				return pack_avx2(dst, reinterpret_cast<const uint16_t*>(src), num_pixels);
+			case X86SimdLevel::SSE41:
+				return pack_sse41(dst, reinterpret_cast<const uint16_t*>(src), num_pixels);
+			default:
+				break;
+			}
+		}
+#endif
+		return 0;
+	}
+
+#if defined(KMSXX_X86_SIMD)
+	/*
+	 * Each source pixel is one 64-bit lane holding the four 16-bit channels.
+	 * Every component is shifted out of its channel and into its place in the
+	 * low 32 bits of the lane, and the low halves are then gathered together.
+	 *
+	 * Lambdas don't inherit the target attributes, so the components are
+	 * iterated with folds over the component indices.
+	 */
+	template<size_t I>
+	__attribute__((target("sse4.1"))) static __m128i pack_component_sse41(__m128i acc, __m128i pix)
+	{
+		if constexpr (channel<I> >= 0) {
+			constexpr int src_shift = 16 * channel<I> + 16 - component<I>::size;
+			constexpr int64_t mask = (1ll << component<I>::size) - 1;
+
+			__m128i v = _mm_srli_epi64(pix, src_shift);
+			v = _mm_and_si128(v, _mm_set1_epi64x(mask));
+			v = _mm_slli_epi64(v, component<I>::offset);
+			acc = _mm_or_si128(acc, v);
+		}
+
+		return acc;
+	}
+
+	template<size_t I>
+	__attribute__((target("avx2"))) static __m256i pack_component_avx2(__m256i acc, __m256i pix)
+	{
+		if constexpr (channel<I> >= 0) {
+			constexpr int src_shift = 16 * channel<I> + 16 - component<I>::size;
+			constexpr int64_t mask = (1ll << component<I>::size) - 1;
+
+			__m256i v = _mm256_srli_epi64(pix, src_shift);
+			v = _mm256_and_si256(v, _mm256_set1_epi64x(mask));
+			v = _mm256_slli_epi64(v, component<I>::offset);
+			acc = _mm256_or_si256(acc, v);
+		}
+
+		return acc;
+	}
+
+	template<size_t... I>
+	__attribute__((target("sse4.1"))) static __m128i pack_lanes_sse41(__m128i pix,
+									  std::index_sequence<I...>)
+	{
+		__m128i acc = _mm_setzero_si128();
+		((acc = pack_component_sse41<I>(acc, pix)), ...);
+		return acc;
+	}
+
+	template<size_t... I>
+	__attribute__((target("avx2"))) static __m256i pack_lanes_avx2(__m256i pix,
+									std::index_sequence<I...>)
+	{
+		__m256i acc = _mm256_setzero_si256();
+		((acc = pack_component_avx2<I>(acc, pix)), ...);
+		return acc;
+	}
+
+	// Pack 4 pixels into 4 32-bit values
+	__attribute__((target("sse4.1"))) static __m128i pack4_sse41(const uint16_t* src)
+	{
+		constexpr auto components = std::make_index_sequence<num_components>{};
+
+		__m128i lo = pack_lanes_sse41(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)),
+					      components);
+		__m128i hi = pack_lanes_sse41(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8)),
+					      components);
+
+		lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 0, 2, 0));
+		hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 0, 2, 0));
+
+		return _mm_unpacklo_epi64(lo, hi);
+	}
+
+	// Pack 8 pixels into 8 32-bit values
+	__attribute__((target("avx2"))) static __m256i pack8_avx2(const uint16_t* src)
+	{
+		constexpr auto components = std::make_index_sequence<num_components>{};
+		const __m256i idx = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+		__m256i lo = pack_lanes_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)),
+					     components);
+		__m256i hi = pack_lanes_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 16)),
+					     components);
+
+		lo = _mm256_permutevar8x32_epi32(lo, idx);
+		hi = _mm256_permutevar8x32_epi32(hi, idx);
+
+		return _mm256_inserti128_si256(lo, _mm256_castsi256_si128(hi), 1);
+	}
+
+	__attribute__((target("sse4.1"))) static size_t pack_sse41(uint8_t* dst, const uint16_t* src,
+								    size_t num_pixels)
+	{
+		size_t x = 0;
+
+		if constexpr (kernel == LineKernel::Packed32) {
+			for (; x + 4 <= num_pixels; x += 4)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4),
+						 pack4_sse41(src + x * 4));
+		} else if constexpr (kernel == LineKernel::Packed16) {
+			for (; x + 8 <= num_pixels; x += 8) {
+				__m128i lo = pack4_sse41(src + x * 4);
+				__m128i hi = pack4_sse41(src + x * 4 + 16);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2),
+						 _mm_packus_epi32(lo, hi));
+			}
+		} else if constexpr (kernel == LineKernel::Bytes24) {
+			x = pack_bytes24_sse41(dst, src, num_pixels, x);
+		}
+
+		return x;
+	}
+
+	__attribute__((target("avx2"))) static size_t pack_avx2(uint8_t* dst, const uint16_t* src,
+								 size_t num_pixels)
+	{
+		size_t x = 0;
+
+		if constexpr (kernel == LineKernel::Packed32) {
+			for (; x + 8 <= num_pixels; x += 8)
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4),
+						    pack8_avx2(src + x * 4));
+			for (; x + 4 <= num_pixels; x += 4)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4),
+						 pack4_sse41(src + x * 4));
+		} else if constexpr (kernel == LineKernel::Packed16) {
+			for (; x + 8 <= num_pixels; x += 8) {
+				__m256i v = pack8_avx2(src + x * 4);
+				__m128i lo = _mm256_castsi256_si128(v);
+				__m128i hi = _mm256_extracti128_si256(v, 1);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2),
+						 _mm_packus_epi32(lo, hi));
+			}
+		} else if constexpr (kernel == LineKernel::Bytes24) {
+			x = pack_bytes24_sse41(dst, src, num_pixels, x);
+		}
+
+		return x;
+	}
+
+	__attribute__((target("sse4.1"))) static size_t pack_bytes24_sse41(uint8_t* dst, const uint16_t* src,
+									    size_t num_pixels, size_t x)
+	{
+		const __m128i shuf = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+						   -1, -1, -1, -1);
+
+		// The 16 byte store writes 4 bytes past the 12 bytes of the pixels
+		for (; x + 4 <= num_pixels && (num_pixels - x) * 3 >= 16; x += 4) {
+			__m128i v = _mm_shuffle_epi8(pack4_sse41(src + x * 4), shuf);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 3), v);
+		}
+
+		return x;
+	}
+#endif
+
+#if defined(__ARM_NEON)
+	// Shift the channel holding component I into the top-aligned component bits
+	template<size_t I>
+	static uint16x8_t neon_component(const uint16x8x4_t& pix)
+	{
+		constexpr size_t shift = 16 - component<I>::size;
+
+		if constexpr (shift == 0)
+			return pix.val[channel<I>];
+		else
+			return vshrq_n_u16(pix.val[channel<I>], shift);
+	}
+
+	static size_t pack_neon(uint8_t* dst, const uint16_t* src, size_t num_pixels)
+	{
+		size_t x = 0;
+
+		for (; x + 8 <= num_pixels; x += 8) {
+			const uint16x8x4_t pix = vld4q_u16(src + x * 4);
+
+			if constexpr (kernel == LineKernel::Packed32) {
+				uint32x4_t lo = vdupq_n_u32(0);
+				uint32x4_t hi = vdupq_n_u32(0);
+
+				static_for<0, num_components>([&](auto i) {
+					if constexpr (channel<i> >= 0) {
+						uint16x8_t v = neon_component<i>(pix);
+						uint32x4_t vlo = vmovl_u16(vget_low_u16(v));
+						uint32x4_t vhi = vmovl_u16(vget_high_u16(v));
+
+						lo = vorrq_u32(lo, vshlq_n_u32(vlo, component<i>::offset));
+						hi = vorrq_u32(hi, vshlq_n_u32(vhi, component<i>::offset));
+					}
+				});
+
+				vst1q_u32(reinterpret_cast<uint32_t*>(dst + x * 4), lo);
+				vst1q_u32(reinterpret_cast<uint32_t*>(dst + x * 4 + 16), hi);
+			} else if constexpr (kernel == LineKernel::Packed16) {
+				uint16x8_t acc = vdupq_n_u16(0);
+
+				static_for<0, num_components>([&](auto i) {
+					if constexpr (channel<i> >= 0)
+						acc = vorrq_u16(acc, vshlq_n_u16(neon_component<i>(pix),
+										 component<i>::offset));
+				});
+
+				vst1q_u16(reinterpret_cast<uint16_t*>(dst + x * 2), acc);
+			} else if constexpr (kernel == LineKernel::Bytes24) {
+				uint8x8x3_t bytes;
+
+				static_for<0, num_components>([&](auto i) {
+					bytes.val[component<i>::offset / 8] =
+						vshrn_n_u16(pix.val[channel<i>], 8);
+				});
+
+				vst3_u8(dst + x * 3, bytes);
+			}
+		}
+
+		return x;
+	}
+#endif
+};
+
+} // namespace kms
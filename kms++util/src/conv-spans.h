@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "conv-simd.h"
+
+namespace kms
+{
+
+/*
+ * Line spans
+ *
+ * A line generator may describe a line as a list of spans, covering the line from
+ * left to right, with a describe_line(y, line, spans) method. A solid span is
+ * a run of a single color. The pixels of other spans, e.g. ramps, are written to
+ * the line buffer at the span's position.
+ *
+ * Writers that pack one pixel per storage unit pack a solid span's color once
+ * and replicate the packed value over the span.
+ */
+
+template<typename TPixel>
+struct LineSpan {
+	size_t start;
+	size_t end; // exclusive
+	bool solid;
+	TPixel color; // only for solid spans
+};
+
+template<typename TPixel>
+using LineSpans = std::vector<LineSpan<TPixel>>;
+
+template<typename TGenerator, typename TPixel>
+constexpr bool has_line_spans = requires(const TGenerator& gen, std::span<TPixel> line,
+					 LineSpans<TPixel>& spans) {
+	gen.describe_line(size_t(0), line, spans);
+};
+
+// Append a solid span, merging it with the previous span if it has the same color
+template<typename TPixel>
+void add_solid_span(LineSpans<TPixel>& spans, size_t start, size_t end, const TPixel& color)
+{
+	if (start == end)
+		return;
+
+	if (!spans.empty()) {
+		LineSpan<TPixel>& last = spans.back();
+
+		if (last.solid && last.end == start &&
+		    memcmp(&last.color, &color, sizeof(TPixel)) == 0) {
+			last.end = end;
+			return;
+		}
+	}
+
+	spans.push_back({ start, end, true, color });
+}
+
+// Fill the solid spans to the line, which already has the pixels of the other spans
+template<typename TPixel>
+void expand_line_spans(const LineSpans<TPixel>& spans, std::span<TPixel> line)
+{
+	for (const auto& span : spans) {
+		if (span.solid)
+			std::fill(line.begin() + span.start, line.begin() + span.end, span.color);
+	}
+}
+
+// Pack a described line to a one-pixel-per-unit plane line
+template<typename Plane, typename TPixel>
+void pack_line_spans(uint8_t* dst, const LineSpans<TPixel>& spans, const TPixel* line)
+{
+	using Packer = PixelLinePacker<Plane, TPixel>;
+
+	for (const auto& span : spans) {
+		uint8_t* p = dst + span.start * Packer::bytes_per_pixel;
+
+		if (span.solid)
+			Packer::fill(p, span.color, span.end - span.start);
+		else
+			Packer::pack(p, line + span.start, span.end - span.start);
+	}
+}
+
+// Write a line from the generator to a one-pixel-per-unit plane line, using the
+// line spans if the generator has them
+template<typename Plane, typename TPixel>
+void write_line(uint8_t* dst, size_t y, auto&& generate_line, std::span<TPixel> line,
+		LineSpans<TPixel>& spans)
+{
+	if constexpr (has_line_spans<std::remove_cvref_t<decltype(generate_line)>, TPixel>) {
+		spans.clear();
+		generate_line.describe_line(y, line, spans);
+		pack_line_spans<Plane>(dst, spans, line.data());
+	} else {
+		generate_line(y, line);
+		PixelLinePacker<Plane, TPixel>::pack(dst, line.data(), line.size());
+	}
+}
+
+} // namespace kms
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <kms++/framebuffer.h>
+#include <kms++/pixelformats.h>
+
+#include "conv-rowmemo.h"
+#include "conv-spans.h"
+
+namespace kms
+{
+
+/*
+ * Stores to write-combined framebuffers
+ *
+ * Write-combined and uncached mappings (see CpuCaching) are slow to read, and
+ * only fast to write with full cacheline stores. The writers' per-pixel stores,
+ * and the row copies of RowMemo, are several times slower there than into
+ * cached memory. So rows for such a framebuffer are drawn into a cached
+ * StagingFramebuffer, and then copied over with stream_copy().
+ */
+
+// Copy len bytes to dst with full 64 byte line stores where possible. On x86 the
+// stores are non-temporal, so dst doesn't evict the staging data from the
+// caches. Elsewhere memcpy already writes in wide sequential stores.
+inline void stream_copy(uint8_t* dst, const uint8_t* src, size_t len)
+{
+#if defined(__SSE2__)
+	const size_t head = std::min(len, (64 - reinterpret_cast<uintptr_t>(dst) % 64) % 64);
+
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	len -= head;
+
+	for (; len >= 64; dst += 64, src += 64, len -= 64) {
+		const __m128i* s = reinterpret_cast<const __m128i*>(src);
+		__m128i* d = reinterpret_cast<__m128i*>(dst);
+
+		_mm_stream_si128(d + 0, _mm_loadu_si128(s + 0));
+		_mm_stream_si128(d + 1, _mm_loadu_si128(s + 1));
+		_mm_stream_si128(d + 2, _mm_loadu_si128(s + 2));
+		_mm_stream_si128(d + 3, _mm_loadu_si128(s + 3));
+	}
+
+	_mm_sfence();
+#endif
+	memcpy(dst, src, len);
+}
+
+// A cached buffer for num_rows rows of fb, with the same format and strides
+class StagingFramebuffer : public IFramebuffer
+{
+public:
+	StagingFramebuffer(IFramebuffer& fb, size_t num_rows)
+		: m_width(fb.width()), m_height(num_rows), m_format(fb.format()),
+		  m_num_planes(fb.num_planes())
+	{
+		const auto& info = get_pixel_format_info(m_format);
+
+		for (size_t p = 0; p < m_num_planes; ++p) {
+			m_vsub[p] = info.planes[p].vsub;
+			m_strides[p] = fb.stride(p);
+			m_row_bytes[p] = info.stride(m_width, p);
+			m_planes[p].resize(m_strides[p] * (num_rows / m_vsub[p]));
+		}
+	}
+
+	uint32_t width() const override { return m_width; }
+	uint32_t height() const override { return m_height; }
+
+	PixelFormat format() const override { return m_format; }
+	unsigned num_planes() const override { return m_num_planes; }
+
+	uint32_t stride(unsigned plane) const override { return m_strides[plane]; }
+	uint32_t size(unsigned plane) const override { return m_planes[plane].size(); }
+	uint32_t offset(unsigned plane) const override { return 0; }
+	uint8_t* map(unsigned plane) override { return m_planes[plane].data(); }
+
+	// Copy the rows start_y...end_y to fb, at the rows fb_y + start_y... Only the
+	// pixel bytes of each row are copied, the stride padding of fb is left as is.
+	void copy_to(IFramebuffer& fb, size_t fb_y, size_t start_y, size_t end_y)
+	{
+		for (size_t p = 0; p < m_num_planes; ++p) {
+			const size_t vsub = m_vsub[p];
+			const size_t stride = m_strides[p];
+			const size_t num_rows = (end_y - start_y + 1) / vsub;
+
+			uint8_t* dst = fb.map(p) + (fb_y + start_y) / vsub * stride;
+			const uint8_t* src = m_planes[p].data() + start_y / vsub * stride;
+
+			for (size_t i = 0; i < num_rows; ++i)
+				stream_copy(dst + i * stride, src + i * stride, m_row_bytes[p]);
+		}
+	}
+
+private:
+	uint32_t m_width;
+	uint32_t m_height;
+	PixelFormat m_format;
+	unsigned m_num_planes;
+
+	std::array<size_t, 4> m_vsub {};
+	std::array<uint32_t, 4> m_strides {};
+	std::array<size_t, 4> m_row_bytes {};
+	std::array<std::vector<uint8_t>, 4> m_planes;
+};
+
+// Line generator drawing the rows of gen starting from row base_y, for drawing
+// them into a StagingFramebuffer
+template<typename TGenerator>
+class OffsetLineGenerator
+{
+public:
+	OffsetLineGenerator(const TGenerator& gen, size_t base_y)
+		: m_gen(gen), m_base_y(base_y)
+	{
+	}
+
+	void operator()(size_t y, auto&& line) const { m_gen(m_base_y + y, line); }
+
+	uint64_t row_key(size_t y) const
+		requires has_row_key<TGenerator>
+	{
+		return m_gen.row_key(m_base_y + y);
+	}
+
+	// Forwarded so that the writers still take the span path for the staged rows
+	template<typename TPixel>
+	void describe_line(size_t y, std::span<TPixel> line, LineSpans<TPixel>& spans) const
+		requires has_line_spans<TGenerator, TPixel>
+	{
+		m_gen.describe_line(m_base_y + y, line, spans);
+	}
+
+private:
+	const TGenerator& m_gen;
+	size_t m_base_y;
+};
+
+} // namespace kms
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <kms++/framebuffer.h>
+#include <kms++/pixelformats.h>
+
+#include "conv.h"
+#include "conv-rowtiles.h"
+#include "conv-store.h"
+
+namespace kms
+{
+
+// Write the rows start_y...end_y directly to the framebuffer's mapping
+template<typename TGeneratorRGB, typename TGeneratorYUV>
+bool write_pattern_lines_direct(IFramebuffer& fb, size_t start_y, size_t end_y,
+			 const TGeneratorRGB& generate_line_rgb,
+			 const TGeneratorYUV& generate_line_yuv)
+{
+#define CASE_ARGB(x)                                                                     \
+	case PixelFormat::x:                                                             \
+		ARGB_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,               \
+						       generate_line_rgb);               \
+		break;
+
+#define CASE_YUV(x)                                                                      \
+	case PixelFormat::x:                                                             \
+		YUV_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,                \
+						      generate_line_yuv);                \
+		break;
+
+#define CASE_YUV_PACKED(x)                                                               \
+	case PixelFormat::x:                                                             \
+		YUVPackedWriter<x##_Layout>::write_pattern(fb, start_y, end_y,           \
+							   generate_line_yuv);           \
+		break;
+
+#define CASE_YUV_SEMI(x)                                                                 \
+	case PixelFormat::x:                                                             \
+		YUVSemiPlanarWriter<x##_Layout>::write_pattern(fb, start_y, end_y,       \
+							       generate_line_yuv);       \
+		break;
+
+#define CASE_YUV_PLANAR(x)                                                               \
+	case PixelFormat::x:                                                             \
+		YUVPlanarWriter<x##_Layout>::write_pattern(fb, start_y, end_y,           \
+							   generate_line_yuv);           \
+		break;
+
+#define CASE_Y_ONLY(x)                                                                   \
+	case PixelFormat::x:                                                             \
+		Y_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,                  \
+						    generate_line_yuv);                  \
+		break;
+
+#define CASE_YUV_PLANAR_PACKED(x)                                                        \
+	case PixelFormat::x:                                                             \
+		YUVPlanarPackedWriter<x##_Layout>::write_pattern(fb, start_y, end_y,     \
+								 generate_line_yuv);     \
+		break;
+
+#define CASE_RAW(x)                                                                      \
+	case PixelFormat::x:                                                             \
+		Bayer_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,              \
+							generate_line_rgb);              \
+		break;
+
+#define CASE_RAW_PACKED(x)                                                               \
+	case PixelFormat::x:                                                             \
+		BayerPacked_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,        \
+							      generate_line_rgb);        \
+		break;
+
+	switch (fb.format()) {
+		CASE_YUV_SEMI(XV20);
+		CASE_YUV_SEMI(XV15);
+		CASE_YUV_SEMI(NV12);
+		CASE_YUV_SEMI(NV21);
+		CASE_YUV_SEMI(NV16);
+		CASE_YUV_SEMI(NV61);
+
+		CASE_ARGB(RGB565);
+		CASE_ARGB(BGR565);
+
+		CASE_ARGB(XRGB1555);
+		CASE_ARGB(ARGB1555);
+		CASE_ARGB(XRGB4444);
+		CASE_ARGB(ARGB4444);
+
+		CASE_ARGB(RGB888);
+		CASE_ARGB(BGR888);
+
+		CASE_ARGB(XRGB8888);
+		CASE_ARGB(ARGB8888);
+		CASE_ARGB(XBGR8888);
+		CASE_ARGB(ABGR8888);
+		CASE_ARGB(RGBX8888);
+		CASE_ARGB(RGBA8888);
+		CASE_ARGB(BGRX8888);
+		CASE_ARGB(BGRA8888);
+		CASE_ARGB(XRGB2101010);
+		CASE_ARGB(ARGB2101010);
+		CASE_ARGB(XBGR2101010);
+		CASE_ARGB(ABGR2101010);
+		CASE_ARGB(RGBX1010102);
+		CASE_ARGB(RGBA1010102);
+		CASE_ARGB(BGRX1010102);
+		CASE_ARGB(BGRA1010102);
+
+		CASE_YUV_PACKED(YUYV);
+		CASE_YUV_PACKED(YVYU);
+		CASE_YUV_PACKED(UYVY);
+		CASE_YUV_PACKED(VYUY);
+
+		CASE_YUV(XVUY2101010);
+
+		CASE_YUV_PLANAR(YUV444);
+		CASE_YUV_PLANAR(YVU444);
+		CASE_YUV_PLANAR(YUV422);
+		CASE_YUV_PLANAR(YVU422);
+		CASE_YUV_PLANAR(YUV420);
+		CASE_YUV_PLANAR(YVU420);
+
+		CASE_Y_ONLY(Y8);
+		CASE_Y_ONLY(Y10_P32);
+
+		CASE_YUV_PLANAR_PACKED(X403);
+
+		CASE_RAW(SRGGB8);
+		CASE_RAW(SGBRG8);
+		CASE_RAW(SGRBG8);
+		CASE_RAW(SBGGR8);
+
+		CASE_RAW(SRGGB10);
+		CASE_RAW(SGBRG10);
+		CASE_RAW(SGRBG10);
+		CASE_RAW(SBGGR10);
+
+		CASE_RAW(SRGGB12);
+		CASE_RAW(SGBRG12);
+		CASE_RAW(SGRBG12);
+		CASE_RAW(SBGGR12);
+
+		CASE_RAW(SRGGB16);
+		CASE_RAW(SGBRG16);
+		CASE_RAW(SGRBG16);
+		CASE_RAW(SBGGR16);
+
+		CASE_RAW_PACKED(SRGGB10P);
+		CASE_RAW_PACKED(SGBRG10P);
+		CASE_RAW_PACKED(SGRBG10P);
+		CASE_RAW_PACKED(SBGGR10P);
+
+		CASE_RAW_PACKED(SRGGB12P);
+		CASE_RAW_PACKED(SGBRG12P);
+		CASE_RAW_PACKED(SGRBG12P);
+		CASE_RAW_PACKED(SBGGR12P);
+
+	default:
+		return false;
+	}
+
+	return true;
+
+#undef CASE_ARGB
+#undef CASE_YUV
+#undef CASE_YUV_PACKED
+#undef CASE_YUV_SEMI
+#undef CASE_YUV_PLANAR
+#undef CASE_Y_ONLY
+#undef CASE_YUV_PLANAR_PACKED
+#undef CASE_RAW
+#undef CASE_RAW_PACKED
+}
+
+// Write the rows start_y...end_y with the writer of the framebuffer's format. RGB and
+// Bayer formats get their lines from generate_line_rgb, YUV formats from
+// generate_line_yuv. Returns false if the format has no writer.
+//
+// The rows of a write-combined framebuffer are drawn in chunks to a cached staging
+// buffer, and copied to the framebuffer with full cacheline stores.
+template<typename TGeneratorRGB, typename TGeneratorYUV>
+bool write_pattern_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			 const TGeneratorRGB& generate_line_rgb,
+			 const TGeneratorYUV& generate_line_yuv)
+{
+	if (fb.cpu_caching() != CpuCaching::WriteCombined)
+		return write_pattern_lines_direct(fb, start_y, end_y, generate_line_rgb,
+						  generate_line_yuv);
+
+	// The chunks start at even rows, so that the Bayer row parity is kept
+	const size_t align = std::lcm(get_max_vsub(fb.format()), size_t(2));
+	const size_t staging_bytes = 128 * 1024;
+
+	const auto& info = get_pixel_format_info(fb.format());
+	size_t row_bytes = 0;
+	for (unsigned p = 0; p < fb.num_planes(); ++p)
+		row_bytes += fb.stride(p) / info.planes[p].vsub;
+
+	// The rows from the aligned start_y to end_y, rounded up to the alignment
+	const size_t num_rows = (end_y - start_y + 2 * align - 1) / align * align;
+	const size_t chunk_rows = std::max(align, staging_bytes / row_bytes / align * align);
+
+	StagingFramebuffer staging(fb, std::min(chunk_rows, num_rows));
+
+	for (size_t y = start_y; y <= end_y;) {
+		const size_t base_y = y / align * align;
+		const size_t last_y = std::min(end_y, base_y + staging.height() - 1);
+
+		if (!write_pattern_lines_direct(staging, y - base_y, last_y - base_y,
+						OffsetLineGenerator(generate_line_rgb, base_y),
+						OffsetLineGenerator(generate_line_yuv, base_y)))
+			return false;
+
+		staging.copy_to(fb, base_y, y - base_y, last_y - base_y);
+
+		y = last_y + 1;
+	}
+
+	return true;
+}
+
+} // namespace kms
@@ -6,6 +6,8 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-line8.h"
+#include "conv-rowmemo.h"
 
 namespace kms
 {
@@ -49,32 +51,78 @@ class YUVPackedWriter
 	static constexpr size_t cb_pos = Plane::template find_pos<ComponentType::Cb>();
 	static constexpr size_t cr_pos = Plane::template find_pos<ComponentType::Cr>();
 
+	static_assert(is_8bit_layout<Layout>);
+
+	// Byte offset of the component at pos in the storage unit
+	template<size_t pos>
+	static constexpr size_t byte_offset =
+		std::tuple_element_t<pos, typename Plane::components_tuple>::offset / 8;
+
 public:
 	static void write_pattern(IFramebuffer& fb, size_t start_y, size_t end_y,
 				  auto&& generate_line)
 	{
-		std::vector<YUV16> linebuf(fb.width());
+		SpanLine<YUV16> line(fb.width());
 
-		auto view = make_strided_fb_view<TStorage>(fb.map(0), fb.height(),
-							   fb.width() / 2, // Two pixels per storage unit
-							   fb.stride(0));
+		RowMemo<1> memo(fb);
 
 		for (size_t y = start_y; y <= end_y; y++) {
-			generate_line(y, linebuf);
+			if (memo.copy_unit(y, generate_line))
+				continue;
+
+			line.generate(y, generate_line);
+
+			// Two pixels per storage unit
+			pack_span_groups<2, 4>(std::array { &std::as_const(line) }, fb.width() / 2,
+					       fb.map(0) + y * fb.stride(0),
+					       [](const auto& pixels, uint8_t* unit) {
+						       const YUV16& pix0 = pixels[0][0];
+						       const YUV16& pix1 = pixels[0][1];
+
+						       unit[byte_offset<y0_pos>] = pix0.y >> 8;
+						       unit[byte_offset<y1_pos>] = pix1.y >> 8;
+						       unit[byte_offset<cb_pos>] = ((pix0.u + pix1.u) / 2) >> 8;
+						       unit[byte_offset<cr_pos>] = ((pix0.v + pix1.v) / 2) >> 8;
+					       });
+		}
+	}
+};
 
-			for (size_t x = 0; x < fb.width(); x += 2) {
-				// Get two pixels
-				const YUV16& pix0 = linebuf[x];
-				const YUV16& pix1 = linebuf[x + 1];
+template<typename Layout>
+class YUVPackedReader
+{
+	using Plane = typename Layout::template plane<0>;
+	using TStorage = typename Plane::storage_type;
 
-				std::array<uint8_t, 4> components;
+	static constexpr size_t y0_pos = Plane::template find_pos<ComponentType::Y0>();
+	static constexpr size_t y1_pos = Plane::template find_pos<ComponentType::Y1>();
+	static constexpr size_t cb_pos = Plane::template find_pos<ComponentType::Cb>();
+	static constexpr size_t cr_pos = Plane::template find_pos<ComponentType::Cr>();
+
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0.
+	// Both pixels of a pair get the pair's chroma.
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<YUV16> auto&& dest)
+	{
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
+
+		auto view = make_strided_fb_view<const TStorage>(fb.map(0), fb.height(),
+								 fb.width() / 2, // Two pixels per storage unit
+								 fb.stride(0));
+
+		for (size_t y = start_y; y <= end_y; y++) {
+			for (size_t x = 0; x < fb.width(); x += 2) {
+				const auto components = Plane::unpack(view(y, x / 2));
 
-				components[y0_pos] = pix0.y >> 8;
-				components[y1_pos] = pix1.y >> 8;
-				components[cb_pos] = ((pix0.u + pix1.u) / 2) >> 8;
-				components[cr_pos] = ((pix0.v + pix1.v) / 2) >> 8;
+				const uint16_t u = components[cb_pos] << 8;
+				const uint16_t v = components[cr_pos] << 8;
 
-				view(y, x / 2) = Plane::pack(components);
+				dest(y - start_y, x) =
+					YUV16 { static_cast<uint16_t>(components[y0_pos] << 8), u, v };
+				dest(y - start_y, x + 1) =
+					YUV16 { static_cast<uint16_t>(components[y1_pos] << 8), u, v };
 			}
 		}
 	}
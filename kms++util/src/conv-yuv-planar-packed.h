@@ -6,6 +6,7 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-rowmemo.h"
 
 namespace kms
 {
@@ -82,7 +83,12 @@ public:
 							fb.height(), fb.width(),
 							fb.stride(Format::cr_plane));
 
+		RowMemo<1> memo(fb);
+
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
+
 			generate_line(y_src, linebuf);
 
 			write_samples<YLayout, ComponentType::Y>(md::submdspan(y_buf, y_src, md::full_extent), linebuf, fb.width());
@@ -122,4 +128,56 @@ private:
 	}
 };
 
+template<typename Format>
+class YUVPlanarPackedReader
+{
+	using YLayout = typename Format::template plane<Format::y_plane>;
+	using CbLayout = typename Format::template plane<Format::cb_plane>;
+	using CrLayout = typename Format::template plane<Format::cr_plane>;
+
+	using TY = typename YLayout::storage_type;
+	using TCb = typename CbLayout::storage_type;
+	using TCr = typename CrLayout::storage_type;
+
+	static constexpr size_t pixels_in_group = 3;
+
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<YUV16> auto&& dest)
+	{
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
+		if (fb.width() % pixels_in_group != 0)
+			throw std::invalid_argument("FB width doesn't align to pixel format");
+
+		for (size_t y = start_y; y <= end_y; y++) {
+			auto dst = md::submdspan(dest, y - start_y, md::full_extent);
+
+			auto y_src = reinterpret_cast<const TY*>(fb.map(Format::y_plane) +
+								 y * fb.stride(Format::y_plane));
+			auto cb_src = reinterpret_cast<const TCb*>(fb.map(Format::cb_plane) +
+								   y * fb.stride(Format::cb_plane));
+			auto cr_src = reinterpret_cast<const TCr*>(fb.map(Format::cr_plane) +
+								   y * fb.stride(Format::cr_plane));
+
+			for (size_t x = 0; x < fb.width(); x += pixels_in_group) {
+				const size_t group = x / pixels_in_group;
+
+				const auto y_values = YLayout::unpack(y_src[group]);
+				const auto cb_values = CbLayout::unpack(cb_src[group]);
+				const auto cr_values = CrLayout::unpack(cr_src[group]);
+
+				static_for<0, pixels_in_group>([&](auto i) {
+					dst[x + i] = YUV16 {
+						static_cast<uint16_t>(y_values[i] << (16 - YLayout::template component_size<i>)),
+						static_cast<uint16_t>(cb_values[i] << (16 - CbLayout::template component_size<i>)),
+						static_cast<uint16_t>(cr_values[i] << (16 - CrLayout::template component_size<i>)),
+					};
+				});
+			}
+		}
+	}
+};
+
 } // namespace kms
@@ -6,6 +6,8 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-line8.h"
+#include "conv-rowmemo.h"
 
 namespace kms
 {
@@ -52,6 +54,9 @@ class YUVPlanarWriter
 	using TY = typename YLayout::storage_type;
 	using TCb = typename CbLayout::storage_type;
 	using TCr = typename CrLayout::storage_type;
+
+	static constexpr bool use_8bit_spans = is_8bit_layout<Format> && sizeof(TY) == 1 &&
+					       sizeof(TCb) == 1 && sizeof(TCr) == 1;
 public:
 	static void write_pattern(IFramebuffer& fb, size_t start_y, size_t end_y,
 				  auto&& generate_line)
@@ -59,6 +64,11 @@ public:
 		assert(start_y % Format::v_sub == 0);
 		assert((end_y + 1) % Format::v_sub == 0);
 
+		if constexpr (use_8bit_spans) {
+			write_pattern_8bit(fb, start_y, end_y, generate_line);
+			return;
+		}
+
 		// Line buffers
 		std::vector<YUV16> linebuf_storage(fb.width() * Format::v_sub);
 		auto linebuf = md::mdspan(linebuf_storage.data(), Format::v_sub, fb.width());
@@ -77,9 +87,18 @@ public:
 							fb.width() / Format::h_sub,
 							fb.stride(Format::cr_plane));
 
+		RowMemo<Format::v_sub> memo(fb);
+		bool copied = false;
+
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
 			size_t y_offset = y_src % Format::v_sub;
 
+			if (y_offset == 0)
+				copied = memo.copy_unit(y_src, generate_line);
+
+			if (copied)
+				continue;
+
 			if (y_offset == 0) {
 				// Fill line buffers
 				for (size_t buf_y = 0; buf_y < Format::v_sub; buf_y++) {
@@ -136,6 +155,60 @@ public:
 	}
 
 private:
+	static void write_pattern_8bit(IFramebuffer& fb, size_t start_y, size_t end_y,
+				       auto&& generate_line)
+	{
+		constexpr size_t h_sub = Format::h_sub;
+		constexpr size_t v_sub = Format::v_sub;
+
+		std::vector<SpanLine<YUV16>> lines(v_sub, SpanLine<YUV16>(fb.width()));
+
+		RowMemo<v_sub> memo(fb);
+
+		for (size_t y_src = start_y; y_src <= end_y; y_src += v_sub) {
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
+
+			std::array<const SpanLine<YUV16>*, v_sub> unit_lines;
+
+			for (size_t y_off = 0; y_off < v_sub; y_off++) {
+				lines[y_off].generate(y_src + y_off, generate_line);
+				unit_lines[y_off] = &lines[y_off];
+
+				pack_span_groups<1, 1>(std::array { unit_lines[y_off] }, fb.width(),
+						       fb.map(Format::y_plane) +
+							       (y_src + y_off) * fb.stride(Format::y_plane),
+						       [](const auto& pixels, uint8_t* unit) {
+							       unit[0] = pixels[0][0].y >> 8;
+						       });
+			}
+
+			// Average the subsampled region
+			auto pack_chroma = [](auto get) {
+				return [get](const auto& pixels, uint8_t* unit) {
+					uint32_t sum = 0;
+
+					for (const auto& row : pixels) {
+						for (const YUV16& pix : row)
+							sum += get(pix);
+					}
+
+					unit[0] = sum / (h_sub * v_sub) >> 8;
+				};
+			};
+
+			pack_span_groups<h_sub, 1>(unit_lines, fb.width() / h_sub,
+						   fb.map(Format::cb_plane) +
+							   y_src / v_sub * fb.stride(Format::cb_plane),
+						   pack_chroma([](const YUV16& pix) { return pix.u; }));
+
+			pack_span_groups<h_sub, 1>(unit_lines, fb.width() / h_sub,
+						   fb.map(Format::cr_plane) +
+							   y_src / v_sub * fb.stride(Format::cr_plane),
+						   pack_chroma([](const YUV16& pix) { return pix.v; }));
+		}
+	}
+
 	template<typename YBuf>
 	static void write_y_line(YBuf& y_buf, size_t y_src, auto& linebuf, size_t y_offset)
 	{
@@ -165,8 +238,23 @@ private:
 			cr_buf(uv_y, uv_x) = CrLayout::pack(v_sum / total_samples >> 8);
 		}
 	}
+};
+
+template<typename Format>
+class YUVPlanarReader
+{
+	using YLayout = typename Format::template plane<Format::y_plane>;
+	using CbLayout = typename Format::template plane<Format::cb_plane>;
+	using CrLayout = typename Format::template plane<Format::cr_plane>;
+
+	using TY = typename YLayout::storage_type;
+	using TCb = typename CbLayout::storage_type;
+	using TCr = typename CrLayout::storage_type;
 
 public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0.
+	// The chroma is not interpolated, all pixels of a subsampling block get the
+	// block's chroma.
 	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
 			       Is2Dspan<YUV16> auto&& dest)
 	{
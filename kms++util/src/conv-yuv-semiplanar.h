@@ -6,6 +6,8 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-line8.h"
+#include "conv-rowmemo.h"
 
 namespace kms
 {
@@ -95,6 +97,10 @@ class YUVSemiPlanarWriter
 	static_assert(pixels_in_group == UVLayout::template component_count<ComponentType::Cb>());
 	static_assert(pixels_in_group == UVLayout::template component_count<ComponentType::Cr>());
 
+	// The NV12 family: a byte per Y, and a Cb, Cr byte pair per UV storage unit
+	static constexpr bool use_8bit_spans = is_8bit_layout<Layout> && pixels_in_group == 1 &&
+					       sizeof(TY) == 1 && sizeof(TCrCb) == 2;
+
 public:
 	static void write_pattern(IFramebuffer& fb, size_t start_y, size_t end_y,
 				  auto&& generate_line)
@@ -104,6 +110,11 @@ public:
 		if (fb.width() % pixels_in_group != 0)
 			throw std::invalid_argument("FB width doesn't align to pixel format");
 
+		if constexpr (use_8bit_spans) {
+			write_pattern_8bit(fb, start_y, end_y, generate_line);
+			return;
+		}
+
 		// Line buffers
 		std::vector<YUV16> linebuf_storage(fb.width() * v_sub);
 		auto linebuf = md::mdspan(linebuf_storage.data(), v_sub, fb.width());
@@ -116,9 +127,18 @@ public:
 							   fb.width() / pixels_in_group / h_sub,
 							   fb.stride(1));
 
+		RowMemo<v_sub> memo(fb);
+		bool copied = false;
+
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
 			size_t y_offset = y_src % v_sub;
 
+			if (y_offset == 0)
+				copied = memo.copy_unit(y_src, generate_line);
+
+			if (copied)
+				continue;
+
 			if (y_offset == 0) {
 				// Fill line buffers
 				for (size_t y_off = 0; y_off < v_sub; y_off++) {
@@ -140,6 +160,51 @@ public:
 	}
 
 private:
+	static void write_pattern_8bit(IFramebuffer& fb, size_t start_y, size_t end_y,
+				       auto&& generate_line)
+	{
+		constexpr size_t cb_byte = UVLayout::template find_pos<ComponentType::Cb>();
+		constexpr size_t cr_byte = UVLayout::template find_pos<ComponentType::Cr>();
+
+		std::vector<SpanLine<YUV16>> lines(v_sub, SpanLine<YUV16>(fb.width()));
+
+		RowMemo<v_sub> memo(fb);
+
+		for (size_t y_src = start_y; y_src <= end_y; y_src += v_sub) {
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
+
+			std::array<const SpanLine<YUV16>*, v_sub> unit_lines;
+
+			for (size_t y_off = 0; y_off < v_sub; y_off++) {
+				lines[y_off].generate(y_src + y_off, generate_line);
+				unit_lines[y_off] = &lines[y_off];
+
+				pack_span_groups<1, 1>(std::array { unit_lines[y_off] }, fb.width(),
+						       fb.map(0) + (y_src + y_off) * fb.stride(0),
+						       [](const auto& pixels, uint8_t* unit) {
+							       unit[0] = pixels[0][0].y >> 8;
+						       });
+			}
+
+			pack_span_groups<h_sub, 2>(unit_lines, fb.width() / h_sub,
+						   fb.map(1) + y_src / v_sub * fb.stride(1),
+						   [](const auto& pixels, uint8_t* unit) {
+							   uint32_t u_sum = 0;
+							   uint32_t v_sum = 0;
+
+							   for (const auto& row : pixels) {
+								   for (const YUV16& pix : row) {
+									   u_sum += pix.u;
+									   v_sum += pix.v;
+								   }
+							   }
+
+							   unit[cb_byte] = u_sum / (h_sub * v_sub) >> 8;
+							   unit[cr_byte] = v_sum / (h_sub * v_sub) >> 8;
+						   });
+		}
+	}
 
 	template<typename YBuf>
 	static void write_y_samples(YBuf&& y_view, auto&& linebuf)
@@ -211,4 +276,74 @@ private:
 	}
 };
 
+template<typename Layout>
+class YUVSemiPlanarReader
+{
+	static_assert(Layout::num_planes == 2);
+
+	static constexpr size_t h_sub = Layout::h_sub;
+	static constexpr size_t v_sub = Layout::v_sub;
+
+	using YLayout = typename Layout::template plane<0>;
+	using UVLayout = typename Layout::template plane<1>;
+
+	using TY = typename YLayout::storage_type;
+	using TCrCb = typename UVLayout::storage_type;
+
+	static constexpr size_t pixels_in_group = YLayout::template component_count<ComponentType::Y>();
+
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0.
+	// The chroma is not interpolated, all pixels of a subsampling block get the
+	// block's chroma.
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<YUV16> auto&& dest)
+	{
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
+		if (fb.width() % (pixels_in_group * h_sub) != 0)
+			throw std::invalid_argument("FB width doesn't align to pixel format");
+
+		auto y_view = make_strided_fb_view<const TY>(fb.map(0), fb.height(),
+							     fb.width() / pixels_in_group, fb.stride(0));
+
+		auto uv_view = make_strided_fb_view<const TCrCb>(fb.map(1), fb.height() / v_sub,
+								 fb.width() / pixels_in_group / h_sub,
+								 fb.stride(1));
+
+		for (size_t y = start_y; y <= end_y; y++) {
+			auto dst = md::submdspan(dest, y - start_y, md::full_extent);
+
+			for (size_t x = 0; x < fb.width(); x += pixels_in_group) {
+				const auto y_values = YLayout::unpack(y_view(y, x / pixels_in_group));
+
+				static_for<0, pixels_in_group>([&](auto i) {
+					dst[x + i].y = y_values[i] << (16 - YLayout::template component_size<i>);
+				});
+			}
+
+			for (size_t x = 0; x < fb.width(); x += pixels_in_group * h_sub) {
+				const auto uv_values =
+					UVLayout::unpack(uv_view(y / v_sub, x / (pixels_in_group * h_sub)));
+
+				static_for<0, pixels_in_group>([&](auto i) {
+					constexpr size_t u_idx = UVLayout::template find_nth_pos<ComponentType::Cb>(i);
+					constexpr size_t v_idx = UVLayout::template find_nth_pos<ComponentType::Cr>(i);
+
+					const uint16_t u = uv_values[u_idx]
+							   << (16 - UVLayout::template component_size<u_idx>);
+					const uint16_t v = uv_values[v_idx]
+							   << (16 - UVLayout::template component_size<v_idx>);
+
+					for (size_t x_off = 0; x_off < h_sub; x_off++) {
+						dst[x + i * h_sub + x_off].u = u;
+						dst[x + i * h_sub + x_off].v = v;
+						dst[x + i * h_sub + x_off].a = YUV16::max_value;
+					}
+				});
+			}
+		}
+	}
+};
+
 } // namespace kms
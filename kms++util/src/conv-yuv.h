@@ -6,6 +6,8 @@
 #include <kms++util/color16.h>
 
 #include "conv-common.h"
+#include "conv-rowmemo.h"
+#include "conv-spans.h"
 
 namespace kms
 {
@@ -110,8 +112,10 @@ public:
 				static_cast<uint16_t>(components[y_idx] << y_shift),
 				static_cast<uint16_t>(components[cb_idx] << cb_shift),
 				static_cast<uint16_t>(components[cr_idx] << cr_shift),
-				static_cast<uint16_t>(has_alpha ? components[a_idx] << a_shift : 0),
 			};
+
+			if constexpr (has_alpha)
+				dst_line[x].a = components[a_idx] << a_shift;
 		}
 	}
 
@@ -119,28 +123,47 @@ public:
 				  auto&& generate_line)
 	{
 		std::vector<YUV16> linebuf(fb.width());
+		LineSpans<YUV16> spans;
 
 		// View to the plane
 		auto view = make_strided_fb_view<TStorage>(fb.map(0), fb.height(), fb.width(),
 							   fb.stride(0));
 
+		RowMemo<1> memo(fb);
+
 		for (size_t y_src = start_y; y_src <= end_y; y_src++) {
-			generate_line(y_src, linebuf);
+			if (memo.copy_unit(y_src, generate_line))
+				continue;
 
 			auto dst = md::submdspan(view, y_src, md::full_extent);
 
-			pack_line(dst, linebuf, fb.width());
+			write_line<Plane, YUV16>(reinterpret_cast<uint8_t*>(&dst[0]), y_src,
+					       generate_line, std::span(linebuf), spans);
 		}
 	}
+};
+
+template<typename Layout>
+class YUV_Reader
+{
+	using TStorage = typename Layout::template plane<0>::storage_type;
 
-	static void get_line(IFramebuffer& fb, size_t w, size_t h, size_t row, std::span<YUV16> linebuf)
+public:
+	// Read and unpack the rows start_y...end_y to dest, starting from dest's row 0
+	static void read_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			       Is2Dspan<YUV16> auto&& dest)
 	{
-		auto view = make_strided_fb_view<const TStorage>(fb.map(0), fb.height(), fb.width(),
-								 fb.stride(0));
+		if (dest.extent(0) < end_y - start_y + 1 || dest.extent(1) < fb.width())
+			throw std::invalid_argument("Destination line buffer too small");
 
-		auto src = md::submdspan(view, row, md::full_extent);
+		const uint8_t* data = fb.map(0);
 
-		unpack_line(linebuf, src);
+		for (size_t y = start_y; y <= end_y; y++) {
+			auto src = reinterpret_cast<const TStorage*>(data + y * fb.stride(0));
+
+			YUV_Writer<Layout>::unpack_line(md::submdspan(dest, y - start_y, md::full_extent),
+							src, fb.width());
+		}
 	}
 };
 
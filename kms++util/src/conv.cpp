@@ -0,0 +1,673 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <kms++/kms++.h>
+#include <kms++util/kms++util.h>
+
+#include "conv.h"
+#include "conv-blend.h"
+#include "conv-rowtiles.h"
+#include "conv-scale.h"
+#include "conv-write.h"
+
+using namespace std;
+
+namespace kms
+{
+
+template<typename TPixel>
+using LineBuffer = md::mdspan<TPixel, md::dextents<size_t, 2>>;
+
+static void read_rgb_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			   LineBuffer<RGB16> dest)
+{
+#define CASE_ARGB(x)                                                                     \
+	case PixelFormat::x:                                                             \
+		ARGB_Reader<x##_Layout>::read_lines(fb, start_y, end_y, dest);           \
+		break;
+
+#define CASE_RAW(x)                                                                      \
+	case PixelFormat::x:                                                             \
+		Bayer_Reader<x##_Layout>::read_lines(fb, start_y, end_y, dest);          \
+		break;
+
+#define CASE_RAW_PACKED(x)                                                               \
+	case PixelFormat::x:                                                             \
+		BayerPacked_Reader<x##_Layout>::read_lines(fb, start_y, end_y, dest);    \
+		break;
+
+	switch (fb.format()) {
+		CASE_ARGB(RGB565);
+		CASE_ARGB(BGR565);
+
+		CASE_ARGB(XRGB1555);
+		CASE_ARGB(ARGB1555);
+		CASE_ARGB(XRGB4444);
+		CASE_ARGB(ARGB4444);
+
+		CASE_ARGB(RGB888);
+		CASE_ARGB(BGR888);
+
+		CASE_ARGB(XRGB8888);
+		CASE_ARGB(ARGB8888);
+		CASE_ARGB(XBGR8888);
+		CASE_ARGB(ABGR8888);
+		CASE_ARGB(RGBX8888);
+		CASE_ARGB(RGBA8888);
+		CASE_ARGB(BGRX8888);
+		CASE_ARGB(BGRA8888);
+		CASE_ARGB(XRGB2101010);
+		CASE_ARGB(ARGB2101010);
+		CASE_ARGB(XBGR2101010);
+		CASE_ARGB(ABGR2101010);
+		CASE_ARGB(RGBX1010102);
+		CASE_ARGB(RGBA1010102);
+		CASE_ARGB(BGRX1010102);
+		CASE_ARGB(BGRA1010102);
+
+		CASE_RAW(SRGGB8);
+		CASE_RAW(SGBRG8);
+		CASE_RAW(SGRBG8);
+		CASE_RAW(SBGGR8);
+
+		CASE_RAW(SRGGB10);
+		CASE_RAW(SGBRG10);
+		CASE_RAW(SGRBG10);
+		CASE_RAW(SBGGR10);
+
+		CASE_RAW(SRGGB12);
+		CASE_RAW(SGBRG12);
+		CASE_RAW(SGRBG12);
+		CASE_RAW(SBGGR12);
+
+		CASE_RAW(SRGGB16);
+		CASE_RAW(SGBRG16);
+		CASE_RAW(SGRBG16);
+		CASE_RAW(SBGGR16);
+
+		CASE_RAW_PACKED(SRGGB10P);
+		CASE_RAW_PACKED(SGBRG10P);
+		CASE_RAW_PACKED(SGRBG10P);
+		CASE_RAW_PACKED(SBGGR10P);
+
+		CASE_RAW_PACKED(SRGGB12P);
+		CASE_RAW_PACKED(SGBRG12P);
+		CASE_RAW_PACKED(SGRBG12P);
+		CASE_RAW_PACKED(SBGGR12P);
+
+	default:
+		throw invalid_argument("unsupported pixel format for reading as RGB");
+	}
+
+#undef CASE_ARGB
+#undef CASE_RAW
+#undef CASE_RAW_PACKED
+}
+
+static void read_yuv_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+			   LineBuffer<YUV16> dest)
+{
+#define CASE_YUV(x)                                                                      \
+	case PixelFormat::x:                                                             \
+		YUV_Reader<x##_Layout>::read_lines(fb, start_y, end_y, dest);            \
+		break;
+
+#define CASE_YUV_PACKED(x)                                                               \
+	case PixelFormat::x:                                                             \
+		YUVPackedReader<x##_Layout>::read_lines(fb, start_y, end_y, dest);       \
+		break;
+
+#define CASE_YUV_SEMI(x)                                                                 \
+	case PixelFormat::x:                                                             \
+		YUVSemiPlanarReader<x##_Layout>::read_lines(fb, start_y, end_y, dest);   \
+		break;
+
+#define CASE_YUV_PLANAR(x)                                                               \
+	case PixelFormat::x:                                                             \
+		YUVPlanarReader<x##_Layout>::read_lines(fb, start_y, end_y, dest);       \
+		break;
+
+#define CASE_Y_ONLY(x)                                                                   \
+	case PixelFormat::x:                                                             \
+		Y_Reader<x##_Layout>::read_lines(fb, start_y, end_y, dest);              \
+		break;
+
+#define CASE_YUV_PLANAR_PACKED(x)                                                        \
+	case PixelFormat::x:                                                             \
+		YUVPlanarPackedReader<x##_Layout>::read_lines(fb, start_y, end_y, dest); \
+		break;
+
+	switch (fb.format()) {
+		CASE_YUV_SEMI(XV20);
+		CASE_YUV_SEMI(XV15);
+		CASE_YUV_SEMI(NV12);
+		CASE_YUV_SEMI(NV21);
+		CASE_YUV_SEMI(NV16);
+		CASE_YUV_SEMI(NV61);
+
+		CASE_YUV_PACKED(YUYV);
+		CASE_YUV_PACKED(YVYU);
+		CASE_YUV_PACKED(UYVY);
+		CASE_YUV_PACKED(VYUY);
+
+		CASE_YUV(XVUY2101010);
+
+		CASE_YUV_PLANAR(YUV444);
+		CASE_YUV_PLANAR(YVU444);
+		CASE_YUV_PLANAR(YUV422);
+		CASE_YUV_PLANAR(YVU422);
+		CASE_YUV_PLANAR(YUV420);
+		CASE_YUV_PLANAR(YVU420);
+
+		CASE_Y_ONLY(Y8);
+		CASE_Y_ONLY(Y10_P32);
+
+		CASE_YUV_PLANAR_PACKED(X403);
+
+	default:
+		throw invalid_argument("unsupported pixel format for reading as YUV");
+	}
+
+#undef CASE_YUV
+#undef CASE_YUV_PACKED
+#undef CASE_YUV_SEMI
+#undef CASE_YUV_PLANAR
+#undef CASE_Y_ONLY
+#undef CASE_YUV_PLANAR_PACKED
+}
+
+template<typename TPixel>
+static void read_framebuffer_lines(IFramebuffer& fb, size_t start_y, size_t end_y,
+				   span<TPixel> dst, unsigned num_threads, auto&& read_lines)
+{
+	if (end_y < start_y || dst.size() < (end_y - start_y + 1) * fb.width())
+		throw invalid_argument("Destination buffer too small");
+
+	run_row_tiles(fb, start_y, end_y, num_threads, {}, false,
+		      [&](size_t tile_start_y, size_t tile_end_y) {
+			      LineBuffer<TPixel> dest(dst.data() + (tile_start_y - start_y) * fb.width(),
+						      tile_end_y - tile_start_y + 1, fb.width());
+
+			      read_lines(fb, tile_start_y, tile_end_y, dest);
+		      });
+}
+
+void read_framebuffer(IFramebuffer& fb, size_t start_y, size_t end_y, span<RGB16> dst,
+		      unsigned num_threads)
+{
+	read_framebuffer_lines(fb, start_y, end_y, dst, num_threads, read_rgb_lines);
+}
+
+void read_framebuffer(IFramebuffer& fb, size_t start_y, size_t end_y, span<YUV16> dst,
+		      unsigned num_threads)
+{
+	read_framebuffer_lines(fb, start_y, end_y, dst, num_threads, read_yuv_lines);
+}
+
+// Write the rows start_y...end_y of dst from the TPixel lines, converting the lines
+// between RGB and YUV if the writer needs the other type
+template<typename TPixel>
+static void write_rows(IFramebuffer& dst, size_t start_y, size_t end_y,
+		       const vector<TPixel>& pixels, const ColorConverter& conv)
+{
+	const size_t width = dst.width();
+
+	auto get_row = [&pixels, start_y, width](size_t y) {
+		return span<const TPixel>(pixels.data() + (y - start_y) * width, width);
+	};
+
+	auto generate_line_rgb = [&](size_t y, span<RGB16> line) {
+		if constexpr (is_same_v<TPixel, RGB16>)
+			ranges::copy(get_row(y), line.begin());
+		else
+			conv.to_rgb(get_row(y), line);
+	};
+
+	auto generate_line_yuv = [&](size_t y, span<YUV16> line) {
+		if constexpr (is_same_v<TPixel, YUV16>)
+			ranges::copy(get_row(y), line.begin());
+		else
+			conv.to_yuv(get_row(y), line);
+	};
+
+	if (!write_pattern_lines(dst, start_y, end_y, generate_line_rgb, generate_line_yuv))
+		throw invalid_argument("unsupported pixel format for writing");
+}
+
+// Convert the rows start_y...end_y: read them from src as TPixel lines, and write them
+// to dst
+template<typename TPixel>
+static void convert_rows(IFramebuffer& src, IFramebuffer& dst, size_t start_y, size_t end_y,
+			 const ColorConverter& conv, auto&& read_lines)
+{
+	const size_t width = src.width();
+
+	vector<TPixel> pixels((end_y - start_y + 1) * width);
+
+	read_lines(src, start_y, end_y, LineBuffer<TPixel>(pixels.data(), end_y - start_y + 1, width));
+
+	write_rows(dst, start_y, end_y, pixels, conv);
+}
+
+// Same format, copy the rows of the planes
+static void copy_rows(IFramebuffer& src, IFramebuffer& dst, size_t start_y, size_t end_y)
+{
+	const auto& info = get_pixel_format_info(src.format());
+
+	for (unsigned p = 0; p < src.num_planes(); ++p) {
+		const size_t vsub = info.planes[p].vsub;
+		const size_t row_bytes = min(info.stride(src.width(), p),
+					     min(src.stride(p), dst.stride(p)));
+
+		for (size_t y = start_y / vsub; y <= end_y / vsub; ++y)
+			memcpy(dst.map(p) + y * dst.stride(p), src.map(p) + y * src.stride(p),
+			       row_bytes);
+	}
+}
+
+void convert_framebuffer(IFramebuffer& src, IFramebuffer& dst, const ConvertOptions& options)
+{
+	if (src.width() != dst.width() || src.height() != dst.height())
+		throw invalid_argument("Source and destination sizes differ");
+
+	const ColorConverter& conv = ColorConverter::get(options.rec, options.range);
+	const bool src_yuv = get_pixel_format_info(src.format()).type == PixelColorType::YUV;
+
+	add_damage(dst);
+
+	// Create the source mmaps before starting the threads
+	for (unsigned p = 0; p < src.num_planes(); ++p)
+		src.map(p);
+
+	run_row_tiles(
+		dst, 0, dst.height() - 1, options.num_threads, options.cpus, false,
+		[&](size_t start_y, size_t end_y) {
+			if (src.format() == dst.format())
+				copy_rows(src, dst, start_y, end_y);
+			else if (src_yuv)
+				convert_rows<YUV16>(src, dst, start_y, end_y, conv, read_yuv_lines);
+			else
+				convert_rows<RGB16>(src, dst, start_y, end_y, conv, read_rgb_lines);
+		},
+		get_max_vsub(src.format()));
+}
+
+// Scale the source rows needed for the rows start_y...end_y of dst horizontally, and
+// then combine them vertically to the dst rows
+template<typename TPixel>
+static void scale_rows(IFramebuffer& src, IFramebuffer& dst, size_t start_y, size_t end_y,
+		       const ScaleTable& h_table, const ScaleTable& v_table,
+		       const ColorConverter& conv, auto&& read_lines)
+{
+	const size_t src_v_sub = get_max_vsub(src.format());
+	const size_t dst_width = dst.width();
+
+	// The source rows, aligned to the source's vertical subsampling for the readers
+	const size_t first = v_table.start(start_y) / src_v_sub * src_v_sub;
+	const size_t last = min((v_table.start(end_y) + v_table.taps() - 1) / src_v_sub * src_v_sub +
+					src_v_sub,
+				(size_t)src.height()) - 1;
+	const size_t num_src_rows = last - first + 1;
+
+	vector<TPixel> src_lines(num_src_rows * src.width());
+
+	read_lines(src, first, last, LineBuffer<TPixel>(src_lines.data(), num_src_rows, src.width()));
+
+	vector<TPixel> h_lines(num_src_rows * dst_width);
+
+	for (size_t r = 0; r < num_src_rows; r++)
+		scale_line_h(reinterpret_cast<uint16_t*>(h_lines.data() + r * dst_width),
+			     reinterpret_cast<const uint16_t*>(src_lines.data() + r * src.width()),
+			     h_table, dst_width);
+
+	vector<TPixel> dst_lines((end_y - start_y + 1) * dst_width);
+	vector<const uint16_t*> rows(v_table.taps());
+
+	for (size_t y = start_y; y <= end_y; y++) {
+		for (size_t k = 0; k < rows.size(); k++)
+			rows[k] = reinterpret_cast<const uint16_t*>(
+				h_lines.data() + (v_table.start(y) + k - first) * dst_width);
+
+		scale_line_v(reinterpret_cast<uint16_t*>(dst_lines.data() + (y - start_y) * dst_width),
+			     rows.data(), v_table.coefs(y), rows.size(), dst_width * 4);
+	}
+
+	write_rows(dst, start_y, end_y, dst_lines, conv);
+}
+
+void scale_framebuffer(IFramebuffer& src, IFramebuffer& dst, const ScaleOptions& options)
+{
+	if (src.width() == dst.width() && src.height() == dst.height()) {
+		convert_framebuffer(src, dst, options);
+		return;
+	}
+
+	const ColorConverter& conv = ColorConverter::get(options.rec, options.range);
+	const bool src_yuv = get_pixel_format_info(src.format()).type == PixelColorType::YUV;
+
+	add_damage(dst);
+
+	const ScaleTable h_table(src.width(), dst.width(), options.filter);
+	const ScaleTable v_table(src.height(), dst.height(), options.filter);
+
+	// Create the source mmaps before starting the threads
+	for (unsigned p = 0; p < src.num_planes(); ++p)
+		src.map(p);
+
+	// Neighbouring tiles scale some of the same source rows, so the tiles are made
+	// as large as the load balancing allows
+	run_row_tiles(dst, 0, dst.height() - 1, options.num_threads, options.cpus, true,
+		      [&](size_t start_y, size_t end_y) {
+			      if (src_yuv)
+				      scale_rows<YUV16>(src, dst, start_y, end_y, h_table, v_table,
+							conv, read_yuv_lines);
+			      else
+				      scale_rows<RGB16>(src, dst, start_y, end_y, h_table, v_table,
+							conv, read_rgb_lines);
+		      });
+}
+
+// A composited layer, with its rects resolved
+struct CompositeSource {
+	IFramebuffer* fb;
+
+	uint32_t src_x;
+	uint32_t src_y;
+	uint32_t src_w;
+	uint32_t src_h;
+
+	int32_t dst_x;
+	int32_t dst_y;
+	uint32_t dst_w;
+	uint32_t dst_h;
+
+	uint16_t alpha;
+	BlendMode blend_mode;
+
+	bool yuv;
+	unsigned alpha_bits;
+
+	// Set if the layer is scaled
+	optional<ScaleTable> h_table;
+	optional<ScaleTable> v_table;
+
+	// Blending the layer is a copy
+	bool opaque() const
+	{
+		return alpha == 0xffff && (blend_mode == BlendMode::None || alpha_bits == 0);
+	}
+};
+
+// The RGB readers shift the components to the top bits, e.g. an opaque 8 bit alpha
+// reads as 0xff00. Find the bits of the format's alpha by writing and reading back
+// transparent and opaque pixels, 0 if there's no alpha.
+static unsigned get_alpha_bits(PixelFormat format)
+{
+	const auto& info = get_pixel_format_info(format);
+
+	if (info.type != PixelColorType::RGB)
+		return 0;
+
+	// The readers view the rows as 16 or 32-bit words, so make the stride a multiple
+	// of 4 bytes also for the 24-bit formats
+	CPUFramebuffer fb(lcm(get<0>(info.pixel_align), 4u), get_max_vsub(format), format);
+	vector<RGB16> pixels(fb.width() * fb.height());
+
+	auto read_alpha = [&](uint16_t alpha) {
+		auto generate_line_rgb = [alpha](size_t y, span<RGB16> line) {
+			ranges::fill(line, RGB16(0, 0, 0, alpha));
+		};
+
+		auto generate_line_yuv = [](size_t y, span<YUV16> line) {
+			ranges::fill(line, YUV16());
+		};
+
+		write_pattern_lines(fb, 0, fb.height() - 1, generate_line_rgb, generate_line_yuv);
+		read_rgb_lines(fb, 0, fb.height() - 1,
+			       LineBuffer<RGB16>(pixels.data(), fb.height(), fb.width()));
+
+		return pixels[0].a;
+	};
+
+	// Formats without alpha read as opaque
+	if (read_alpha(0) != 0)
+		return 0;
+
+	return 16 - countr_zero(read_alpha(0xffff));
+}
+
+// Widen the alpha of the pixels from bits to 16 bits, by replicating the bits
+static void widen_alpha(span<RGB16> pixels, unsigned bits)
+{
+	if (bits == 0 || bits >= 16)
+		return;
+
+	for (RGB16& pix : pixels) {
+		const uint32_t a = pix.a;
+		uint32_t wide = a;
+
+		for (unsigned s = bits; s < 16; s += bits)
+			wide |= a >> s;
+
+		pix.a = wide;
+	}
+}
+
+// Read the rows first_row...last_row of the layer's destination rect to lines of
+// dst_w RGB16 pixels, scaling them if needed
+template<typename TPixel>
+static void read_layer_rows(const CompositeSource& s, size_t first_row, size_t last_row,
+			    vector<RGB16>& lines, const ColorConverter& conv, auto&& read_lines)
+{
+	IFramebuffer& src = *s.fb;
+	const size_t src_v_sub = get_max_vsub(src.format());
+	const size_t num_rows = last_row - first_row + 1;
+
+	size_t src_first = s.src_y + first_row;
+	size_t src_last = s.src_y + last_row;
+
+	if (s.v_table) {
+		src_first = s.src_y + s.v_table->start(first_row);
+		src_last = s.src_y + s.v_table->start(last_row) + s.v_table->taps() - 1;
+	}
+
+	// The source rows, aligned to the source's vertical subsampling for the readers
+	const size_t first = src_first / src_v_sub * src_v_sub;
+	const size_t last = min((src_last / src_v_sub + 1) * src_v_sub, (size_t)src.height()) - 1;
+	const size_t num_src_rows = last - first + 1;
+
+	vector<TPixel> src_lines(num_src_rows * src.width());
+
+	read_lines(src, first, last, LineBuffer<TPixel>(src_lines.data(), num_src_rows, src.width()));
+
+	// RGB lines are produced directly to the output, YUV lines are converted to it
+	vector<TPixel> yuv_lines;
+	TPixel* layer_lines;
+
+	lines.resize(num_rows * s.dst_w);
+
+	if constexpr (is_same_v<TPixel, YUV16>) {
+		yuv_lines.resize(num_rows * s.dst_w);
+		layer_lines = yuv_lines.data();
+	} else {
+		layer_lines = lines.data();
+	}
+
+	if (s.h_table) {
+		vector<TPixel> h_lines(num_src_rows * s.dst_w);
+
+		for (size_t r = 0; r < num_src_rows; r++)
+			scale_line_h(reinterpret_cast<uint16_t*>(h_lines.data() + r * s.dst_w),
+				     reinterpret_cast<const uint16_t*>(src_lines.data() + r * src.width() +
+								       s.src_x),
+				     *s.h_table, s.dst_w);
+
+		vector<const uint16_t*> rows(s.v_table->taps());
+
+		for (size_t i = 0; i < num_rows; i++) {
+			const size_t row = first_row + i;
+
+			for (size_t k = 0; k < rows.size(); k++)
+				rows[k] = reinterpret_cast<const uint16_t*>(
+					h_lines.data() + (s.src_y + s.v_table->start(row) + k - first) * s.dst_w);
+
+			scale_line_v(reinterpret_cast<uint16_t*>(layer_lines + i * s.dst_w),
+				     rows.data(), s.v_table->coefs(row), rows.size(), s.dst_w * 4);
+		}
+	} else {
+		for (size_t i = 0; i < num_rows; i++) {
+			const TPixel* row = src_lines.data() + (s.src_y + first_row + i - first) * src.width() +
+					    s.src_x;
+
+			copy(row, row + s.dst_w, layer_lines + i * s.dst_w);
+		}
+	}
+
+	if constexpr (is_same_v<TPixel, YUV16>)
+		conv.to_rgb(yuv_lines, lines);
+
+	widen_alpha(lines, s.alpha_bits);
+}
+
+// Blend the layers for the rows start_y...end_y of dst, and write the rows
+static void composite_rows(const vector<CompositeSource>& sources, IFramebuffer& dst,
+			   size_t start_y, size_t end_y, const RGB16& background,
+			   const ColorConverter& conv)
+{
+	const int64_t width = dst.width();
+
+	auto covers_tile = [&](const CompositeSource& s) {
+		return s.dst_x <= 0 && s.dst_x + (int64_t)s.dst_w >= width &&
+		       s.dst_y <= (int64_t)start_y && s.dst_y + (int64_t)s.dst_h > (int64_t)end_y;
+	};
+
+	// Skip the layers below the topmost opaque layer covering the tile
+	size_t bottom = 0;
+	for (size_t i = sources.size(); i > 0; i--) {
+		if (sources[i - 1].opaque() && covers_tile(sources[i - 1])) {
+			bottom = i - 1;
+			break;
+		}
+	}
+
+	vector<RGB16> pixels((end_y - start_y + 1) * width, background);
+	vector<RGB16> lines;
+
+	for (size_t i = bottom; i < sources.size(); i++) {
+		const CompositeSource& s = sources[i];
+
+		const int64_t y1 = max<int64_t>(start_y, s.dst_y);
+		const int64_t y2 = min<int64_t>(end_y, (int64_t)s.dst_y + s.dst_h - 1);
+		const int64_t x1 = max<int64_t>(0, s.dst_x);
+		const int64_t x2 = min<int64_t>(width, (int64_t)s.dst_x + s.dst_w);
+
+		if (y1 > y2 || x1 >= x2)
+			continue;
+
+		if (s.yuv)
+			read_layer_rows<YUV16>(s, y1 - s.dst_y, y2 - s.dst_y, lines, conv,
+					       read_yuv_lines);
+		else
+			read_layer_rows<RGB16>(s, y1 - s.dst_y, y2 - s.dst_y, lines, conv,
+					       read_rgb_lines);
+
+		// Opaque layers are copied, blend_line() does that for BlendMode::None
+		const BlendMode mode = s.opaque() ? BlendMode::None : s.blend_mode;
+
+		for (int64_t y = y1; y <= y2; y++)
+			blend_line(pixels.data() + (y - start_y) * width + x1,
+				   lines.data() + (y - y1) * s.dst_w + (x1 - s.dst_x), x2 - x1,
+				   s.alpha, mode);
+	}
+
+	write_rows(dst, start_y, end_y, pixels, conv);
+}
+
+void composite_framebuffers(span<const CompositeLayer> layers, IFramebuffer& dst,
+			    const CompositeOptions& options)
+{
+	const ColorConverter& conv = ColorConverter::get(options.rec, options.range);
+
+	vector<const CompositeLayer*> sorted;
+	for (const CompositeLayer& layer : layers)
+		sorted.push_back(&layer);
+
+	ranges::stable_sort(sorted, {}, &CompositeLayer::zpos);
+
+	vector<CompositeSource> sources;
+	bool scaled = false;
+
+	for (const CompositeLayer* layer : sorted) {
+		if (!layer->fb)
+			throw invalid_argument("Composite layer without a framebuffer");
+
+		IFramebuffer& fb = *layer->fb;
+		CompositeSource s;
+
+		s.fb = &fb;
+		s.src_x = layer->src_x;
+		s.src_y = layer->src_y;
+		s.src_w = layer->src_w ? layer->src_w : fb.width() - min(layer->src_x, fb.width());
+		s.src_h = layer->src_h ? layer->src_h : fb.height() - min(layer->src_y, fb.height());
+
+		if (s.src_w == 0 || s.src_h == 0 || (uint64_t)s.src_x + s.src_w > fb.width() ||
+		    (uint64_t)s.src_y + s.src_h > fb.height())
+			throw invalid_argument("Composite layer source rect outside the framebuffer");
+
+		s.dst_x = layer->dst_x;
+		s.dst_y = layer->dst_y;
+		s.dst_w = layer->dst_w ? layer->dst_w : s.src_w;
+		s.dst_h = layer->dst_h ? layer->dst_h : s.src_h;
+
+		s.alpha = layer->alpha;
+		s.blend_mode = layer->blend_mode;
+
+		s.yuv = get_pixel_format_info(fb.format()).type == PixelColorType::YUV;
+		s.alpha_bits = get_alpha_bits(fb.format());
+
+		if (s.src_w != s.dst_w || s.src_h != s.dst_h) {
+			s.h_table.emplace(s.src_w, s.dst_w, options.filter);
+			s.v_table.emplace(s.src_h, s.dst_h, options.filter);
+			scaled = true;
+		}
+
+		// Create the source mmaps before starting the threads
+		for (unsigned p = 0; p < fb.num_planes(); ++p)
+			fb.map(p);
+
+		sources.push_back(std::move(s));
+	}
+
+	add_damage(dst);
+
+	run_row_tiles(dst, 0, dst.height() - 1, options.num_threads, options.cpus, scaled,
+		      [&](size_t start_y, size_t end_y) {
+			      composite_rows(sources, dst, start_y, end_y, options.background, conv);
+		      });
+}
+
+string get_simd_level()
+{
+#if defined(__ARM_NEON)
+	return "neon";
+#elif defined(KMSXX_X86_SIMD)
+	switch (x86_simd_level()) {
+	case X86SimdLevel::AVX2:
+		return "avx2";
+	case X86SimdLevel::SSE41:
+		return "sse4.1";
+	default:
+		return "none";
+	}
+#else
+	return "none";
+#endif
+}
+
+} // namespace kms
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <kms++util/damage.h>
+
+using namespace std;
+
+namespace kms
+{
+static uint64_t rect_area(const DamageRect& r)
+{
+	return (uint64_t)r.width * r.height;
+}
+
+static bool rect_contains(const DamageRect& a, const DamageRect& b)
+{
+	return b.x >= a.x && b.y >= a.y && b.x + b.width <= a.x + a.width &&
+	       b.y + b.height <= a.y + a.height;
+}
+
+// True if the rects overlap or share an edge
+static bool rect_touches(const DamageRect& a, const DamageRect& b)
+{
+	return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height &&
+	       b.y <= a.y + a.height;
+}
+
+static DamageRect rect_union(const DamageRect& a, const DamageRect& b)
+{
+	const uint32_t x1 = min(a.x, b.x);
+	const uint32_t y1 = min(a.y, b.y);
+	const uint32_t x2 = max(a.x + a.width, b.x + b.width);
+	const uint32_t y2 = max(a.y + a.height, b.y + b.height);
+
+	return { x1, y1, x2 - x1, y2 - y1 };
+}
+
+void DamageRegion::add(const DamageRect& rect)
+{
+	if (rect.width == 0 || rect.height == 0)
+		return;
+
+	DamageRect r = rect;
+
+	// Absorb the rects touching r, again as long as the union grows
+	for (bool merged = true; merged;) {
+		merged = false;
+
+		for (auto it = m_rects.begin(); it != m_rects.end();) {
+			if (rect_contains(*it, r))
+				return;
+
+			if (rect_touches(*it, r)) {
+				r = rect_union(*it, r);
+				it = m_rects.erase(it);
+				merged = true;
+			} else {
+				++it;
+			}
+		}
+	}
+
+	m_rects.push_back(r);
+
+	if (m_rects.size() <= max_rects)
+		return;
+
+	size_t best_i = 0;
+	size_t best_j = 1;
+	uint64_t best_growth = UINT64_MAX;
+
+	for (size_t i = 0; i < m_rects.size(); ++i) {
+		for (size_t j = i + 1; j < m_rects.size(); ++j) {
+			uint64_t growth = rect_area(rect_union(m_rects[i], m_rects[j])) -
+					  rect_area(m_rects[i]) - rect_area(m_rects[j]);
+
+			if (growth < best_growth) {
+				best_growth = growth;
+				best_i = i;
+				best_j = j;
+			}
+		}
+	}
+
+	m_rects[best_i] = rect_union(m_rects[best_i], m_rects[best_j]);
+	m_rects.erase(m_rects.begin() + best_j);
+}
+
+void DamageRegion::add(const DamageRegion& region)
+{
+	for (const DamageRect& r : region.m_rects)
+		add(r);
+}
+
+/*
+ * The trackers by framebuffer. Drawing to framebuffers without a tracker is
+ * the common case, so it only costs an atomic load when there are none.
+ */
+static mutex s_trackers_mutex;
+static unordered_map<const IFramebuffer*, DamageTracker*> s_trackers;
+static atomic<size_t> s_num_trackers;
+
+DamageTracker::DamageTracker(IFramebuffer& fb)
+	: m_fb(fb)
+{
+	lock_guard lock(s_trackers_mutex);
+
+	if (!s_trackers.emplace(&fb, this).second)
+		throw runtime_error("Framebuffer already has a damage tracker");
+
+	s_num_trackers++;
+}
+
+DamageTracker::~DamageTracker()
+{
+	lock_guard lock(s_trackers_mutex);
+
+	s_trackers.erase(&m_fb);
+	s_num_trackers--;
+}
+
+void DamageTracker::add(const DamageRect& rect)
+{
+	lock_guard lock(s_trackers_mutex);
+
+	m_region.add(rect);
+}
+
+DamageRegion DamageTracker::take()
+{
+	lock_guard lock(s_trackers_mutex);
+
+	DamageRegion region = std::move(m_region);
+	m_region.clear();
+	return region;
+}
+
+void add_damage(IFramebuffer& fb, const DamageRect& rect)
+{
+	if (s_num_trackers.load(memory_order_relaxed) == 0)
+		return;
+
+	if (rect.x >= fb.width() || rect.y >= fb.height())
+		return;
+
+	const DamageRect r = {
+		rect.x,
+		rect.y,
+		min(rect.width, fb.width() - rect.x),
+		min(rect.height, fb.height() - rect.y),
+	};
+
+	lock_guard lock(s_trackers_mutex);
+
+	auto it = s_trackers.find(&fb);
+	if (it == s_trackers.end())
+		return;
+
+	it->second->m_region.add(r);
+}
+
+void add_damage(IFramebuffer& fb)
+{
+	add_damage(fb, { 0, 0, fb.width(), fb.height() });
+}
+
+bool add_damage_clips(AtomicReq& req, Plane* plane, const DamageRegion& region)
+{
+	if (!plane->get_prop("FB_DAMAGE_CLIPS"))
+		return false;
+
+	if (region.empty())
+		return true;
+
+	// struct drm_mode_rect
+	struct Clip {
+		int32_t x1;
+		int32_t y1;
+		int32_t x2;
+		int32_t y2;
+	};
+
+	vector<Clip> clips;
+	clips.reserve(region.rects().size());
+
+	for (const DamageRect& r : region.rects())
+		clips.push_back({ (int32_t)r.x, (int32_t)r.y, (int32_t)(r.x + r.width),
+				  (int32_t)(r.y + r.height) });
+
+	req.add_blob(plane, "FB_DAMAGE_CLIPS", clips.data(), clips.size() * sizeof(Clip));
+
+	return true;
+}
+
+void flush_damage(Framebuffer& fb, const DamageRegion& region)
+{
+	for (const DamageRect& r : region.rects())
+		fb.flush(r.x, r.y, r.width, r.height);
+}
+
+} // namespace kms
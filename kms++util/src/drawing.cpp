@@ -1,5 +1,5 @@
-
-#include <cmath>
+#include <algorithm>
+#include <memory>
 
 #include <kms++/kms++.h>
 #include <kms++util/kms++util.h>
@@ -14,6 +14,8 @@ void draw_rgb_pixel(IFramebuffer& buf, unsigned x, unsigned y, RGB color)
 	if (x >= buf.width() || y >= buf.height())
 		throw runtime_error("attempt to draw outside the buffer");
 
+	add_damage(buf, { x, y, 1, 1 });
+
 	switch (buf.format()) {
 	case PixelFormat::XRGB8888:
 	case PixelFormat::ARGB8888: {
@@ -114,6 +116,8 @@ void draw_yuv444_pixel(IFramebuffer& buf, unsigned x, unsigned y, YUV yuv)
 	if (x >= buf.width() || y >= buf.height())
 		throw runtime_error("attempt to draw outside the buffer");
 
+	add_damage(buf, { x, y, 1, 1 });
+
 	uint8_t* py = reinterpret_cast<uint8_t*>(buf.map(0) + buf.stride(0) * y + x);
 	uint8_t* pu = reinterpret_cast<uint8_t*>(buf.map(1) + buf.stride(1) * y + x);
 	uint8_t* pv = reinterpret_cast<uint8_t*>(buf.map(2) + buf.stride(2) * y + x);
@@ -304,6 +308,8 @@ void draw_yuv422_macropixel(IFramebuffer& buf, unsigned x, unsigned y, YUV yuv1,
 	if ((x + 1) >= buf.width() || y >= buf.height())
 		throw runtime_error("attempt to draw outside the buffer");
 
+	add_damage(buf, { x, y, 2, 1 });
+
 	ASSERT((x & 1) == 0);
 
 	switch (buf.format()) {
@@ -420,6 +426,8 @@ void draw_yuv420_macropixel(IFramebuffer& buf, unsigned x, unsigned y,
 	if ((x + 1) >= buf.width() || (y + 1) >= buf.height())
 		throw runtime_error("attempt to draw outside the buffer");
 
+	add_damage(buf, { x, y, 2, 2 });
+
 	ASSERT((x & 1) == 0);
 	ASSERT((y & 1) == 0);
 
@@ -441,184 +449,66 @@ void draw_yuv420_macropixel(IFramebuffer& buf, unsigned x, unsigned y,
 
 void draw_rect(IFramebuffer& fb, uint32_t x, uint32_t y, uint32_t w, uint32_t h, RGB color)
 {
-	unsigned i, j;
-	YUV yuvcolor = color.yuv();
+	if (w == 0 || h == 0)
+		return;
 
-	switch (fb.format()) {
-	case PixelFormat::XRGB8888:
-	case PixelFormat::XBGR8888:
-	case PixelFormat::ARGB8888:
-	case PixelFormat::ABGR8888:
-	case PixelFormat::RGB888:
-	case PixelFormat::BGR888:
-	case PixelFormat::RGB565:
-	case PixelFormat::BGR565:
-	case PixelFormat::XRGB4444:
-	case PixelFormat::XRGB1555:
-	case PixelFormat::ARGB4444:
-	case PixelFormat::ARGB1555:
-	case PixelFormat::RGB332:
-		for (j = 0; j < h; j++) {
-			for (i = 0; i < w; i++) {
-				draw_rgb_pixel(fb, x + i, y + j, color);
-			}
-		}
-		break;
+	Canvas canvas(fb);
 
-	case PixelFormat::YUV444:
-	case PixelFormat::YVU444:
-		for (j = 0; j < h; j++) {
-			for (i = 0; i < w; i++) {
-				draw_yuv444_pixel(fb, x + i, y + j, yuvcolor);
-			}
-		}
-		break;
+	// The rect is drawn in units of whole macropixels
+	const uint32_t unit_width = canvas.unit_width();
+	const uint32_t unit_rows = canvas.unit_rows();
 
-	case PixelFormat::UYVY:
-	case PixelFormat::YUYV:
-	case PixelFormat::YVYU:
-	case PixelFormat::VYUY:
-	case PixelFormat::NV16:
-	case PixelFormat::NV61:
-	case PixelFormat::YUV422:
-	case PixelFormat::YVU422:
-		for (j = 0; j < h; j++) {
-			for (i = 0; i < w; i += 2) {
-				draw_yuv422_macropixel(fb, x + i, y + j, yuvcolor, yuvcolor);
-			}
-		}
-		break;
+	ASSERT(x % unit_width == 0);
+	ASSERT(y % unit_rows == 0);
 
-	case PixelFormat::NV12:
-	case PixelFormat::NV21:
-	case PixelFormat::YUV420:
-	case PixelFormat::YVU420:
-		for (j = 0; j < h; j += 2) {
-			for (i = 0; i < w; i += 2) {
-				draw_yuv420_macropixel(fb, x + i, y + j,
-						       yuvcolor, yuvcolor, yuvcolor, yuvcolor);
-			}
-		}
-		break;
-	default:
-		throw std::invalid_argument("draw_rect: unknown pixelformat");
-	}
+	w = (w + unit_width - 1) / unit_width * unit_width;
+	h = (h + unit_rows - 1) / unit_rows * unit_rows;
+
+	if (x + w > fb.width() || y + h > fb.height())
+		throw runtime_error("attempt to draw outside the buffer");
+
+	canvas.fill_rect(x, y, w, h, color);
 }
 
 void draw_horiz_line(IFramebuffer& fb, uint32_t x1, uint32_t x2, uint32_t y, RGB color)
 {
-	for (uint32_t x = x1; x <= x2; ++x)
-		draw_rgb_pixel(fb, x, y, color);
-}
+	if (x1 > x2)
+		return;
 
-void draw_circle(IFramebuffer& fb, int32_t xCenter, int32_t yCenter, int32_t radius, RGB color)
-{
-	int32_t r2 = radius * radius;
+	if (x2 >= fb.width() || y >= fb.height())
+		throw runtime_error("attempt to draw outside the buffer");
 
-	for (int y = -radius; y <= radius; y++) {
-		int32_t x = (int)(sqrt(r2 - y * y) + 0.5);
-		draw_horiz_line(fb, xCenter - x, xCenter + x, yCenter - y, color);
-	}
+	Canvas(fb).draw_hline(x1, x2, y, color);
 }
 
-static bool get_char_pixel(char c, uint32_t x, uint32_t y)
+void draw_circle(IFramebuffer& fb, int32_t xCenter, int32_t yCenter, int32_t radius, RGB color)
 {
-#include "font_8x8.h"
-
-	uint8_t bits = fontdata_8x8[8 * c + y];
-	bool bit = (bits >> (7 - x)) & 1;
+	if (xCenter - radius < 0 || yCenter - radius < 0 ||
+	    xCenter + radius >= (int32_t)fb.width() || yCenter + radius >= (int32_t)fb.height())
+		throw runtime_error("attempt to draw outside the buffer");
 
-	return bit;
+	Canvas(fb).fill_circle(xCenter, yCenter, radius, color);
 }
 
-static void draw_char(IFramebuffer& buf, uint32_t xpos, uint32_t ypos, char c, RGB color)
+void draw_text(IFramebuffer& buf, uint32_t x, uint32_t y, const string& str, RGB color)
 {
-	// Skip characters that are not fully drawable
-	if (xpos + 8 > buf.width() || ypos + 8 > buf.height())
-		return;
-
-	unsigned x, y;
-	YUV yuvcolor = color.yuv();
-
-	switch (buf.format()) {
-	case PixelFormat::XRGB8888:
-	case PixelFormat::XBGR8888:
-	case PixelFormat::ARGB8888:
-	case PixelFormat::ABGR8888:
-	case PixelFormat::RGB888:
-	case PixelFormat::BGR888:
-	case PixelFormat::RGB565:
-	case PixelFormat::BGR565:
-	case PixelFormat::XRGB4444:
-	case PixelFormat::XRGB1555:
-	case PixelFormat::ARGB4444:
-	case PixelFormat::ARGB1555:
-	case PixelFormat::RGB332:
-		for (y = 0; y < 8; y++) {
-			for (x = 0; x < 8; x++) {
-				bool b = get_char_pixel(c, x, y);
-
-				draw_rgb_pixel(buf, xpos + x, ypos + y, b ? color : RGB());
-			}
-		}
-		break;
-
-	case PixelFormat::YUV444:
-	case PixelFormat::YVU444:
-		for (y = 0; y < 8; y++) {
-			for (x = 0; x < 8; x++) {
-				bool b = get_char_pixel(c, x, y);
-
-				draw_yuv444_pixel(buf, xpos + x, ypos + y, b ? yuvcolor : YUV(RGB()));
-			}
-		}
-		break;
+	// The renderers of the last few formats and colors drawn by this thread
+	thread_local vector<unique_ptr<TextRenderer>> renderers;
 
-	case PixelFormat::UYVY:
-	case PixelFormat::YUYV:
-	case PixelFormat::YVYU:
-	case PixelFormat::VYUY:
-	case PixelFormat::NV16:
-	case PixelFormat::NV61:
-	case PixelFormat::YUV422:
-	case PixelFormat::YVU422:
-		for (y = 0; y < 8; y++) {
-			for (x = 0; x < 8; x += 2) {
-				bool b0 = get_char_pixel(c, x, y);
-				bool b1 = get_char_pixel(c, x + 1, y);
+	auto it = find_if(renderers.begin(), renderers.end(), [&](const auto& r) {
+		return r->format() == buf.format() && r->fg().argb8888() == color.argb8888() &&
+		       r->bg().argb8888() == RGB().argb8888() && r->scale() == 1;
+	});
 
-				draw_yuv422_macropixel(buf, xpos + x, ypos + y,
-						       b0 ? yuvcolor : YUV(RGB()), b1 ? yuvcolor : YUV(RGB()));
-			}
-		}
-		break;
+	if (it == renderers.end()) {
+		if (renderers.size() == 4)
+			renderers.erase(renderers.begin());
 
-	case PixelFormat::NV12:
-	case PixelFormat::NV21:
-	case PixelFormat::YUV420:
-	case PixelFormat::YVU420:
-		for (y = 0; y < 8; y += 2) {
-			for (x = 0; x < 8; x += 2) {
-				bool b00 = get_char_pixel(c, x, y);
-				bool b10 = get_char_pixel(c, x + 1, y);
-				bool b01 = get_char_pixel(c, x, y + 1);
-				bool b11 = get_char_pixel(c, x + 1, y + 1);
-
-				draw_yuv420_macropixel(buf, xpos + x, ypos + y,
-						       b00 ? yuvcolor : YUV(RGB()), b10 ? yuvcolor : YUV(RGB()),
-						       b01 ? yuvcolor : YUV(RGB()), b11 ? yuvcolor : YUV(RGB()));
-			}
-		}
-		break;
-	default:
-		throw std::invalid_argument("draw_char: unknown pixelformat");
+		renderers.push_back(make_unique<TextRenderer>(buf.format(), color));
+		it = renderers.end() - 1;
 	}
-}
 
-void draw_text(IFramebuffer& buf, uint32_t x, uint32_t y, const string& str, RGB color)
-{
-	for (unsigned i = 0; i < str.size(); i++)
-		draw_char(buf, (x + 8 * i), y, str[i], color);
+	(*it)->draw(buf, x, y, str);
 }
 
 } // namespace kms
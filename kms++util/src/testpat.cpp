@@ -1,7 +1,8 @@
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <fmt/format.h>
-#include <functional>
 #include <optional>
 #include <span>
 #include <stdexcept>
@@ -15,6 +16,9 @@
 #include <kms++util/kms++util.h>
 
 #include "conv.h"
+#include "conv-rowtiles.h"
+#include "conv-spans.h"
+#include "conv-write.h"
 
 using namespace std;
 
@@ -101,19 +105,89 @@ static RGB16 get_test_pattern_pixel_16(size_t w, size_t h, size_t x, size_t y)
 	}
 }
 
-static void get_test_pattern_line(size_t w, size_t h, size_t row, std::span<RGB16> buf)
+// The rows inside the top and the bottom margins, except the outermost rows, are
+// identical. Other rows have diagonal lines and gradients.
+static uint64_t get_test_pattern_row_key(size_t h, size_t y)
 {
-	for (size_t x = 0; x < w; ++x)
-		buf[x] = get_test_pattern_pixel_16(w, h, x, row);
+	const unsigned mw = 20;
+
+	if (h <= 2 * mw + 2)
+		return unique_row_key;
+
+	if (y > 0 && y < mw)
+		return 0;
+
+	if (y > h - mw - 1 && y < h - 1)
+		return 1;
+
+	return unique_row_key;
 }
 
-static void get_test_pattern_line_yuv(size_t w, size_t h, size_t row,
-				      std::span<YUV16> buf,
-				      const TestPatternOptions& options)
+// Describe a line as solid spans, by getting the color at the start of each interval
+// between the break points. The break points must include all x positions where the
+// color may change.
+template<typename TPixel>
+static void describe_line_from_breaks(size_t w, std::vector<size_t>& breaks,
+				      LineSpans<TPixel>& spans, auto&& get_pixel)
 {
-	for (size_t x = 0; x < w; ++x)
-		buf[x] = get_test_pattern_pixel_16(w, h, x, row)
-				 .to_yuv(options.rec, options.range);
+	breaks.push_back(0);
+	breaks.push_back(w);
+
+	std::sort(breaks.begin(), breaks.end());
+	breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+
+	for (size_t i = 0; i + 1 < breaks.size() && breaks[i] < w; ++i)
+		add_solid_span(spans, breaks[i], min(breaks[i + 1], w), get_pixel(breaks[i]));
+}
+
+// The color changes only at the margins, the corner boxes, the diagonal lines and the
+// gradient bars, so each line is described by evaluating get_test_pattern_pixel_16()
+// at those x positions only
+template<typename TPixel>
+static void describe_test_pattern_line(size_t w, size_t h, size_t y, LineSpans<TPixel>& spans,
+				       auto&& convert)
+{
+	const unsigned mw = 20;
+
+	const unsigned xm1 = mw;
+	const unsigned xm2 = w - mw - 1;
+
+	std::vector<size_t> breaks { 1, w - 1, xm1, xm1 + 1, xm2, xm2 + 1 };
+
+	// diagonal lines
+	breaks.insert(breaks.end(), { y, y + 1, h - y - 1, h - y });
+	if (w + y >= h)
+		breaks.insert(breaks.end(), { w + y - h, w + y - h + 1 });
+	if (y < w)
+		breaks.insert(breaks.end(), { w - y - 1, w - y });
+
+	// gradient bars
+	if (xm2 > xm1 + 1) {
+		const size_t bar_width = xm2 - xm1 - 1;
+
+		for (size_t t = 1; t < 8; ++t)
+			breaks.push_back(xm1 + 1 + (t * bar_width + 7) / 8);
+	}
+
+	describe_line_from_breaks(w, breaks, spans, [&](size_t x) {
+		return convert(get_test_pattern_pixel_16(w, h, x, y));
+	});
+}
+
+// The SMPTE pattern consists of four horizontal bands. Rows within a band are identical.
+static size_t get_smpte_band(size_t h, size_t y)
+{
+	const size_t pattern1_height = (h * 7) / 12;
+	const size_t pattern2_height = pattern1_height + (h / 12);
+	const size_t pattern3_height = pattern2_height + (h / 12);
+
+	if (y < pattern1_height)
+		return 0;
+	if (y < pattern2_height)
+		return 1;
+	if (y < pattern3_height)
+		return 2;
+	return 3;
 }
 
 // SMPTE RP 219-1:2014
@@ -150,13 +224,10 @@ static YUV16 get_smpte_pixel(size_t w, size_t h, size_t x, size_t y)
 	const size_t c = (a * 3 / 4) / 7;
 	const size_t d = a / 8;
 
-	// Pattern heights
-	const size_t pattern1_height = (h * 7) / 12;
-	const size_t pattern2_height = pattern1_height + (h / 12);
-	const size_t pattern3_height = pattern2_height + (h / 12);
+	const size_t band = get_smpte_band(h, y);
 
 	// Pattern 1 (75% color bars)
-	if (y < pattern1_height) {
+	if (band == 0) {
 		if (x < d || x >= (a - d))
 			return gray40;
 
@@ -180,7 +251,7 @@ static YUV16 get_smpte_pixel(size_t w, size_t h, size_t x, size_t y)
 	}
 
 	// Pattern 2 (Color difference reference)
-	if (y >= pattern1_height && y < pattern2_height) {
+	if (band == 1) {
 		if (x < d)
 			return cyan100;
 
@@ -191,7 +262,7 @@ static YUV16 get_smpte_pixel(size_t w, size_t h, size_t x, size_t y)
 	}
 
 	// Pattern 3 (Ramp)
-	if (y >= pattern2_height && y < pattern3_height) {
+	if (band == 2) {
 		if (x < d)
 			return yellow100;
 
@@ -206,7 +277,7 @@ static YUV16 get_smpte_pixel(size_t w, size_t h, size_t x, size_t y)
 	}
 
 	// Pattern 4 (PLUGE)
-	if (y >= pattern3_height) {
+	if (band == 3) {
 		const size_t c0 = d;
 		const size_t c1 = c0 + c * 3 / 2;
 		const size_t c2 = c1 + 2 * c;
@@ -249,283 +320,385 @@ static YUV16 get_smpte_pixel(size_t w, size_t h, size_t x, size_t y)
 	return black;
 }
 
-static void get_smpte_line_rgb(size_t w, size_t h, size_t row, std::span<RGB16> buf,
-			       const TestPatternOptions& options)
+// The SMPTE pattern is made of solid bars, except the ramp in the third band, which is
+// written pixel by pixel to the line
+template<typename TPixel>
+static void describe_smpte_line(size_t w, size_t h, size_t y, std::span<TPixel> line,
+				LineSpans<TPixel>& spans, auto&& convert)
 {
-	for (size_t x = 0; x < w; ++x)
-		buf[x] = get_smpte_pixel(w, h, x, row)
-				 .to_rgb(RecStandard::BT709, ColorRange::Limited);
+	// Same as in get_smpte_pixel()
+	constexpr size_t M = 1024;
+	const size_t a = w * M;
+	const size_t c = (a * 3 / 4) / 7;
+	const size_t d = a / 8;
+
+	const size_t c0 = d;
+	const size_t c1 = c0 + c * 3 / 2;
+	const size_t c2 = c1 + 2 * c;
+	const size_t c3 = c2 + c * 5 / 6;
+
+	// First pixel at or after the given high precision position
+	auto to_pixel = [](size_t pos) { return (pos + M - 1) / M; };
+
+	auto get_pixel = [&](size_t x) { return convert(get_smpte_pixel(w, h, x, y)); };
+
+	if (get_smpte_band(h, y) == 2) {
+		const size_t ramp_start = min(to_pixel(d), w);
+		const size_t ramp_end = max(min(to_pixel(a - d), w), ramp_start);
+
+		add_solid_span(spans, 0, ramp_start, get_pixel(0));
+
+		for (size_t x = ramp_start; x < ramp_end; ++x)
+			line[x] = get_pixel(x);
+
+		if (ramp_start < ramp_end)
+			spans.push_back({ ramp_start, ramp_end, false, {} });
+
+		if (ramp_end < w)
+			add_solid_span(spans, ramp_end, w, get_pixel(ramp_end));
+
+		return;
+	}
+
+	std::vector<size_t> breaks { to_pixel(d), to_pixel(a - d), to_pixel(a - d - c) };
+
+	// color bars
+	for (size_t i = 1; i < 7; ++i)
+		breaks.push_back(to_pixel(d + i * c));
+
+	// PLUGE
+	breaks.insert(breaks.end(), { to_pixel(c1), to_pixel(c2), to_pixel(c3) });
+	for (size_t i = 1; i < 5; ++i)
+		breaks.push_back(to_pixel(c3 + i * (c / 3)));
+
+	describe_line_from_breaks(w, breaks, spans, get_pixel);
 }
 
-static void get_smpte_line_yuv(size_t w, size_t h, size_t row, std::span<YUV16> buf,
-                               const TestPatternOptions& options)
+/*
+ * Line generators
+ *
+ * Each pattern has its own generator type, so the writers are instantiated for each
+ * pattern, with the generator calls inlined into the writers' loops. The generators
+ * describe the lines as spans (see conv-spans.h) and give the row equivalence keys
+ * (see conv-rowmemo.h).
+ */
+
+struct NoConversion {
+	template<typename TPixel>
+	TPixel operator()(const TPixel& pix) const { return pix; }
+};
+
+class RGBToYUV
 {
-	for (size_t x = 0; x < w; ++x)
-		buf[x] = get_smpte_pixel(w, h, x, row);
-}
+public:
+	explicit RGBToYUV(const ColorConverter& conv)
+		: m_conv(conv)
+	{
+	}
 
-static void get_plain_line_rgb(size_t w, const RGB16& color, std::span<RGB16> buf)
+	YUV16 operator()(const RGB16& rgb) const { return m_conv.to_yuv(rgb); }
+
+private:
+	const ColorConverter& m_conv;
+};
+
+class YUVToRGB
 {
-	for (size_t x = 0; x < w; ++x)
-		buf[x] = color;
-}
+public:
+	explicit YUVToRGB(const ColorConverter& conv)
+		: m_conv(conv)
+	{
+	}
 
-static void get_plain_line_yuv(size_t w, const YUV16& color, std::span<YUV16> buf)
+	RGB16 operator()(const YUV16& yuv) const { return m_conv.to_rgb(yuv); }
+
+private:
+	const ColorConverter& m_conv;
+};
+
+// Generates full lines from the spans of the derived generator
+template<typename TDerived, typename TPixel>
+class SpanLineGenerator
 {
-	for (size_t x = 0; x < w; ++x)
-		buf[x] = color;
-}
+public:
+	void operator()(size_t y, std::span<TPixel> line) const
+	{
+		m_scratch_spans.clear();
+		static_cast<const TDerived*>(this)->describe_line(y, line, m_scratch_spans);
+		expand_line_spans(m_scratch_spans, line);
+	}
 
-static void draw_test_pattern_part(IFramebuffer& fb, size_t start_y, size_t end_y,
-				   const TestPatternOptions& options)
+private:
+	mutable LineSpans<TPixel> m_scratch_spans;
+};
+
+template<typename TPixel>
+class SolidLineGenerator : public SpanLineGenerator<SolidLineGenerator<TPixel>, TPixel>
 {
-	std::optional<RGB16> solid;
+public:
+	SolidLineGenerator(const IFramebuffer& fb, const TPixel& color)
+		: m_width(fb.width()), m_color(color)
+	{
+	}
+
+	void describe_line(size_t y, std::span<TPixel> line, LineSpans<TPixel>& spans) const
+	{
+		add_solid_span(spans, 0, m_width, m_color);
+	}
+
+	uint64_t row_key(size_t y) const { return 0; }
+
+private:
+	size_t m_width;
+	TPixel m_color;
+};
+
+template<typename TPixel, typename TConvert>
+class SmpteLineGenerator
+	: public SpanLineGenerator<SmpteLineGenerator<TPixel, TConvert>, TPixel>
+{
+public:
+	SmpteLineGenerator(const IFramebuffer& fb, TConvert convert)
+		: m_width(fb.width()), m_height(fb.height()), m_convert(convert)
+	{
+	}
 
+	void describe_line(size_t y, std::span<TPixel> line, LineSpans<TPixel>& spans) const
+	{
+		describe_smpte_line(m_width, m_height, y, line, spans, m_convert);
+	}
+
+	uint64_t row_key(size_t y) const { return get_smpte_band(m_height, y); }
+
+private:
+	size_t m_width;
+	size_t m_height;
+	TConvert m_convert;
+};
+
+template<typename TPixel, typename TConvert>
+class DefaultLineGenerator
+	: public SpanLineGenerator<DefaultLineGenerator<TPixel, TConvert>, TPixel>
+{
+public:
+	DefaultLineGenerator(const IFramebuffer& fb, TConvert convert)
+		: m_width(fb.width()), m_height(fb.height()), m_convert(convert)
+	{
+	}
+
+	void describe_line(size_t y, std::span<TPixel> line, LineSpans<TPixel>& spans) const
+	{
+		describe_test_pattern_line(m_width, m_height, y, spans, m_convert);
+	}
+
+	uint64_t row_key(size_t y) const { return get_test_pattern_row_key(m_height, y); }
+
+private:
+	size_t m_width;
+	size_t m_height;
+	TConvert m_convert;
+};
+
+static std::optional<RGB16> get_solid_color(const TestPatternOptions& options)
+{
 	if (options.pattern == "red")
-		solid = RGB16(0xffff, 0, 0);
+		return RGB16(0xffff, 0, 0);
 	else if (options.pattern == "green")
-		solid = RGB16(0, 0xffff, 0);
+		return RGB16(0, 0xffff, 0);
 	else if (options.pattern == "blue")
-		solid = RGB16(0, 0, 0xffff);
+		return RGB16(0, 0, 0xffff);
 	else if (options.pattern == "white")
-		solid = RGB16(0xffff, 0xffff, 0xffff);
+		return RGB16(0xffff, 0xffff, 0xffff);
 	else if (options.pattern == "black")
-		solid = RGB16(0, 0, 0);
-
-	std::function<void(size_t y, std::span<RGB16> span)> generate_line_rgb;
-	std::function<void(size_t y, std::span<YUV16> span)> generate_line_yuv;
-
-	if (solid.has_value()) {
-		generate_line_rgb = [&fb, rgb = solid.value()](size_t y,
-							     std::span<RGB16> span) {
-			get_plain_line_rgb(fb.width(), rgb, span);
-		};
-
-		generate_line_yuv = [&fb, rgb = solid.value(),
-				     &options](size_t y, std::span<YUV16> span) {
-			get_plain_line_yuv(fb.width(),
-					   rgb.to_yuv(options.rec, options.range), span);
-		};
-	} else if (options.pattern == "smpte") {
-		generate_line_rgb = [&fb, &options](size_t y, std::span<RGB16> span) {
-			get_smpte_line_rgb(fb.width(), fb.height(), y, span, options);
-		};
+		return RGB16(0, 0, 0);
 
-		generate_line_yuv = [&fb, &options](size_t y, std::span<YUV16> span) {
-			get_smpte_line_yuv(fb.width(), fb.height(), y, span, options);
-		};
-	} else {
-		generate_line_rgb = [&fb](size_t y, std::span<RGB16> span) {
-			get_test_pattern_line(fb.width(), fb.height(), y, span);
-		};
-
-		generate_line_yuv = [&fb, &options](size_t y, std::span<YUV16> span) {
-			get_test_pattern_line_yuv(fb.width(), fb.height(), y, span,
-						   options);
-		};
+	return std::nullopt;
+}
+
+/*
+ * Solid color fills
+ *
+ * The color is packed once per plane by drawing a few full width rows of the format
+ * with the writers, which covers the chroma planes and the Bayer cells too. The rows
+ * are copied to the framebuffer rows, or memset if all their bytes are equal. The
+ * framebuffer is only written, never read.
+ */
+class SolidFill
+{
+public:
+	SolidFill(IFramebuffer& fb, const RGB16& rgb, const ColorConverter& conv)
+	{
+		const auto& info = get_pixel_format_info(fb.format());
+
+		// High enough for the vertical subsampling and the Bayer row pairs
+		uint32_t tile_height = 2;
+		for (const auto& plane_info : info.planes)
+			tile_height = max<uint32_t>(tile_height, plane_info.vsub);
+
+		// The rows are drawn twice, on differently filled tiles, to find the bytes
+		// the writers leave untouched at the end of the rows (e.g. X403, where the
+		// stride from the pixel format info is larger than the packed row)
+		CPUFramebuffer tile(fb.width(), tile_height, fb.format());
+		CPUFramebuffer tile_check(fb.width(), tile_height, fb.format());
+
+		for (unsigned p = 0; p < tile.num_planes(); ++p) {
+			memset(tile.map(p), 0, tile.size(p));
+			memset(tile_check.map(p), 0xff, tile_check.size(p));
+		}
+
+		for (IFramebuffer* t : { (IFramebuffer*)&tile, (IFramebuffer*)&tile_check })
+			write_pattern_lines(*t, 0, tile_height - 1, SolidLineGenerator<RGB16>(*t, rgb),
+					    SolidLineGenerator<YUV16>(*t, conv.to_yuv(rgb)));
+
+		m_planes.resize(fb.num_planes());
+
+		for (unsigned p = 0; p < fb.num_planes(); ++p) {
+			PlaneFill& plane = m_planes[p];
+
+			plane.vsub = info.planes[p].vsub;
+
+			for (size_t r = 0; r < tile_height / plane.vsub; ++r) {
+				const uint8_t* src = tile.map(p) + r * tile.stride(p);
+				const uint8_t* check = tile_check.map(p) + r * tile.stride(p);
+				size_t row_bytes = min(tile.stride(p), fb.stride(p));
+				RowFill row;
+
+				while (row_bytes && src[row_bytes - 1] != check[row_bytes - 1])
+					row_bytes--;
+
+				row.data.assign(src, src + row_bytes);
+
+				row.uniform = std::all_of(row.data.begin(), row.data.end(),
+							  [&row](uint8_t v) { return v == row.data[0]; });
+
+				plane.rows.push_back(std::move(row));
+			}
+		}
 	}
 
-#define CASE_ARGB(x)                                                                     \
-	case PixelFormat::x:                                                             \
-		ARGB_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,               \
-						       generate_line_rgb);               \
-		break;
-
-#define CASE_YUV(x)                                                                      \
-	case PixelFormat::x:                                                             \
-		YUV_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,                \
-						      generate_line_yuv);                \
-		break;
-
-#define CASE_YUV_PACKED(x)                                                               \
-	case PixelFormat::x:                                                             \
-		YUVPackedWriter<x##_Layout>::write_pattern(fb, start_y, end_y,           \
-							   generate_line_yuv);           \
-		break;
-
-#define CASE_YUV_SEMI(x)                                                                 \
-	case PixelFormat::x:                                                             \
-		YUVSemiPlanarWriter<x##_Layout>::write_pattern(fb, start_y, end_y,       \
-							       generate_line_yuv);       \
-		break;
-
-#define CASE_YUV_PLANAR(x)                                                               \
-	case PixelFormat::x:                                                             \
-		YUVPlanarWriter<x##_Layout>::write_pattern(fb, start_y, end_y,           \
-							   generate_line_yuv);           \
-		break;
-
-#define CASE_Y_ONLY(x)                                                                   \
-	case PixelFormat::x:                                                             \
-		Y_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,                  \
-						    generate_line_yuv);                  \
-		break;
-
-#define CASE_YUV_PLANAR_PACKED(x)                                                        \
-	case PixelFormat::x:                                                             \
-		YUVPlanarPackedWriter<x##_Layout>::write_pattern(fb, start_y, end_y,     \
-								 generate_line_yuv);     \
-		break;
-
-#define CASE_RAW(x)                                                                      \
-	case PixelFormat::x:                                                             \
-		Bayer_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,              \
-							generate_line_rgb);              \
-		break;
-
-#define CASE_RAW_PACKED(x)                                                               \
-	case PixelFormat::x:                                                             \
-		BayerPacked_Writer<x##_Layout>::write_pattern(fb, start_y, end_y,        \
-							      generate_line_rgb);        \
-		break;
-
-	switch (fb.format()) {
-		CASE_YUV_SEMI(XV20);
-		CASE_YUV_SEMI(XV15);
-		CASE_YUV_SEMI(NV12);
-		CASE_YUV_SEMI(NV21);
-		CASE_YUV_SEMI(NV16);
-		CASE_YUV_SEMI(NV61);
-
-		CASE_ARGB(RGB565);
-		CASE_ARGB(BGR565);
-
-		CASE_ARGB(XRGB1555);
-		CASE_ARGB(ARGB1555);
-		CASE_ARGB(XRGB4444);
-		CASE_ARGB(ARGB4444);
-
-		CASE_ARGB(RGB888);
-		CASE_ARGB(BGR888);
-
-		CASE_ARGB(XRGB8888);
-		CASE_ARGB(ARGB8888);
-		CASE_ARGB(XBGR8888);
-		CASE_ARGB(ABGR8888);
-		CASE_ARGB(RGBX8888);
-		CASE_ARGB(RGBA8888);
-		CASE_ARGB(BGRX8888);
-		CASE_ARGB(BGRA8888);
-		CASE_ARGB(XRGB2101010);
-		CASE_ARGB(ARGB2101010);
-		CASE_ARGB(XBGR2101010);
-		CASE_ARGB(ABGR2101010);
-		CASE_ARGB(RGBX1010102);
-		CASE_ARGB(RGBA1010102);
-		CASE_ARGB(BGRX1010102);
-		CASE_ARGB(BGRA1010102);
-
-		CASE_YUV_PACKED(YUYV);
-		CASE_YUV_PACKED(YVYU);
-		CASE_YUV_PACKED(UYVY);
-		CASE_YUV_PACKED(VYUY);
-
-		CASE_YUV(XVUY2101010);
-
-		CASE_YUV_PLANAR(YUV444);
-		CASE_YUV_PLANAR(YVU444);
-		CASE_YUV_PLANAR(YUV422);
-		CASE_YUV_PLANAR(YVU422);
-		CASE_YUV_PLANAR(YUV420);
-		CASE_YUV_PLANAR(YVU420);
-
-		CASE_Y_ONLY(Y8);
-		CASE_Y_ONLY(Y10_P32);
-
-		CASE_YUV_PLANAR_PACKED(X403);
-
-		CASE_RAW(SRGGB8);
-		CASE_RAW(SGBRG8);
-		CASE_RAW(SGRBG8);
-		CASE_RAW(SBGGR8);
-
-		CASE_RAW(SRGGB10);
-		CASE_RAW(SGBRG10);
-		CASE_RAW(SGRBG10);
-		CASE_RAW(SBGGR10);
-
-		CASE_RAW(SRGGB12);
-		CASE_RAW(SGBRG12);
-		CASE_RAW(SGRBG12);
-		CASE_RAW(SBGGR12);
-
-		CASE_RAW(SRGGB16);
-		CASE_RAW(SGBRG16);
-		CASE_RAW(SGRBG16);
-		CASE_RAW(SBGGR16);
-
-		CASE_RAW_PACKED(SRGGB10P);
-		CASE_RAW_PACKED(SGBRG10P);
-		CASE_RAW_PACKED(SGRBG10P);
-		CASE_RAW_PACKED(SBGGR10P);
-
-		CASE_RAW_PACKED(SRGGB12P);
-		CASE_RAW_PACKED(SGBRG12P);
-		CASE_RAW_PACKED(SGRBG12P);
-		CASE_RAW_PACKED(SBGGR12P);
-
-	default:
-		break;
+	// Fill rows start_y...end_y, aligned to the vertical subsampling
+	void fill_rows(IFramebuffer& fb, size_t start_y, size_t end_y) const
+	{
+		const bool write_combined = fb.cpu_caching() == CpuCaching::WriteCombined;
+
+		for (unsigned p = 0; p < m_planes.size(); ++p) {
+			const PlaneFill& plane = m_planes[p];
+			uint8_t* data = fb.map(p);
+			const size_t stride = fb.stride(p);
+
+			for (size_t r = start_y / plane.vsub; r <= end_y / plane.vsub; ++r) {
+				const RowFill& row = plane.rows[r % plane.rows.size()];
+				uint8_t* dst = data + r * stride;
+
+				if (row.data.empty())
+					continue;
+
+				if (row.uniform)
+					memset(dst, row.data[0], row.data.size());
+				else if (write_combined)
+					stream_copy(dst, row.data.data(), row.data.size());
+				else
+					memcpy(dst, row.data.data(), row.data.size());
+			}
+		}
 	}
-}
 
-void draw_test_pattern_multi(IFramebuffer& fb, const TestPatternOptions& options)
+private:
+	struct RowFill {
+		std::vector<uint8_t> data;
+		bool uniform;
+	};
+
+	struct PlaneFill {
+		size_t vsub;
+		std::vector<RowFill> rows;
+	};
+
+	std::vector<PlaneFill> m_planes;
+};
+
+static void draw_test_pattern_part(IFramebuffer& fb, size_t start_y, size_t end_y,
+				   const TestPatternOptions& options)
 {
-	const auto& info = get_pixel_format_info(fb.format());
-	uint8_t v_sub = 0;
-	for (size_t p = 0; p < info.num_planes; ++p)
-		v_sub = max(v_sub, info.planes[p].vsub);
+	const ColorConverter& conv = ColorConverter::get(options.rec, options.range);
 
-	if (!v_sub || fb.height() % v_sub)
-		throw invalid_argument("FB height must be divisible with vsub");
+	if (auto solid = get_solid_color(options)) {
+		SolidFill(fb, *solid, conv).fill_rows(fb, start_y, end_y);
+	} else if (options.pattern == "smpte") {
+		// The SMPTE pattern is defined in BT.709 limited range YUV
+		const ColorConverter& smpte_conv = ColorConverter::get(RecStandard::BT709,
+								       ColorRange::Limited);
 
-	// Create the mmaps before starting the threads
-	for (size_t i = 0; i < fb.num_planes(); ++i)
-		fb.map(i);
+		write_pattern_lines(fb, start_y, end_y,
+				    SmpteLineGenerator<RGB16, YUVToRGB>(fb, YUVToRGB(smpte_conv)),
+				    SmpteLineGenerator<YUV16, NoConversion>(fb, {}));
+	} else {
+		write_pattern_lines(fb, start_y, end_y,
+				    DefaultLineGenerator<RGB16, NoConversion>(fb, {}),
+				    DefaultLineGenerator<YUV16, RGBToYUV>(fb, RGBToYUV(conv)));
+	}
+}
 
-	size_t num_threads = thread::hardware_concurrency();
+// Fill fb with the color, without adding damage
+static void fill_solid_color(IFramebuffer& fb, const RGB16& color, const TestPatternOptions& options)
+{
+	SolidFill fill(fb, color, ColorConverter::get(options.rec, options.range));
 
-	size_t part_height = fb.height() / num_threads;
+	run_row_tiles(fb, 0, fb.height() - 1, options.num_threads, options.cpus, true,
+		      [&fb, &fill](size_t start_y, size_t end_y) {
+			      fill.fill_rows(fb, start_y, end_y);
+		      });
+}
 
-	// round up to v_sub
-	part_height = (part_height + v_sub - 1) / v_sub * v_sub;
+void draw_solid_color(IFramebuffer& fb, const RGB16& color, const TestPatternOptions& options)
+{
+	add_damage(fb);
+	fill_solid_color(fb, color, options);
+}
 
-	vector<thread> workers;
+bool test_pattern_supports_format(PixelFormat format)
+{
+	const auto& info = get_pixel_format_info(format);
 
-	std::vector<std::exception_ptr> errors(num_threads);
+	// Wide enough for the writers' word accesses
+	auto [width, height] = info.align_pixels(64, get_max_vsub(format));
+	CPUFramebuffer fb(width, height, format);
 
-	for (size_t n = 0; n < num_threads; ++n) {
-		size_t start = n * part_height;
-		size_t end = start + part_height - 1;
+	return write_pattern_lines(fb, 0, fb.height() - 1, [](size_t y, span<RGB16> line) {},
+				   [](size_t y, span<YUV16> line) {});
+}
 
-		if (n == num_threads - 1)
-			end = fb.height() - 1;
+void draw_test_pattern_multi(IFramebuffer& fb, const TestPatternOptions& options)
+{
+	add_damage(fb);
 
-		workers.push_back(thread([&fb, start, end, &options, &error = errors[n]]() {
-			try {
-				draw_test_pattern_part(fb, start, end, options);
-			} catch (...) {
-				error = std::current_exception();
-			}
-		}));
+	if (auto solid = get_solid_color(options)) {
+		fill_solid_color(fb, *solid, options);
+		return;
 	}
 
-	for (thread& t : workers)
-		t.join();
+	bool row_bands = options.pattern == "smpte";
 
-	auto i = std::find_if(errors.begin(), errors.end(),
-			      [](const auto& e) { return e != nullptr; });
-	if (i != errors.end())
-		std::rethrow_exception(*i);
+	run_row_tiles(fb, 0, fb.height() - 1, options.num_threads, options.cpus, row_bands,
+		      [&fb, &options](size_t start_y, size_t end_y) {
+			      draw_test_pattern_part(fb, start_y, end_y, options);
+		      });
 }
 
 void draw_test_pattern_single(IFramebuffer& fb, const TestPatternOptions& options)
 {
+	add_damage(fb);
 	draw_test_pattern_part(fb, 0, fb.height() - 1, options);
 }
 
 void draw_test_pattern(IFramebuffer& fb, const TestPatternOptions& options)
 {
+	if (options.cache) {
+		add_damage(fb);
+		options.cache->draw(fb, options);
+		return;
+	}
+
 #ifdef HAS_PTHREAD
 	draw_test_pattern_multi(fb, options);
 #else
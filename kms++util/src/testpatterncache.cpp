@@ -0,0 +1,393 @@
+#include <array>
+#include <cstring>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <kms++util/kms++util.h>
+#include <kms++util/testpatterncache.h>
+#include <kms++util/threadpool.h>
+
+#include "conv-store.h"
+
+using namespace std;
+
+namespace kms
+{
+/*
+ * The frame files have a header with a magic and the key, followed by the planes,
+ * page aligned so that the mapped planes are aligned too
+ */
+static const char frame_file_magic[8] = { 'K', 'M', 'S', 'X', 'X', 'T', 'P', '1' };
+static constexpr size_t frame_data_align = 4096;
+
+// Copies are split into chunks of about this size for the thread pool
+static constexpr size_t copy_chunk_size = 1024 * 1024;
+
+// The version of the rendered frames. Bump it when the drawing of the test
+// patterns changes, so that frame files stored by older builds are not used.
+static constexpr unsigned frame_version = 1;
+
+struct TestPatternCache::Frame {
+	~Frame()
+	{
+		if (mapping)
+			munmap(mapping, mapping_size);
+	}
+
+	// Planes, one after the other
+	uint8_t* data = nullptr;
+	size_t size = 0;
+	unsigned num_planes = 0;
+	array<size_t, 4> plane_offsets {};
+	array<size_t, 4> plane_sizes {};
+
+	// Either the frame is in memory, or mapped from a file
+	vector<uint8_t> memory;
+	void* mapping = nullptr;
+	size_t mapping_size = 0;
+};
+
+// The key has everything that affects the contents of the planes
+static string make_key(IFramebuffer& fb, const TestPatternOptions& options)
+{
+	string key = fmt::format("v{}-{}x{}-{}", frame_version, fb.width(), fb.height(),
+				 pixel_format_to_fourcc_str(fb.format()));
+
+	for (unsigned p = 0; p < fb.num_planes(); ++p)
+		key += fmt::format("-{}", fb.stride(p));
+
+	key += fmt::format("-{}-{}-{}", (int)options.rec, (int)options.range, options.pattern);
+
+	return key;
+}
+
+// The planes hold the rows written when drawing, including the strides
+void TestPatternCache::get_plane_layout(IFramebuffer& fb, Frame& frame)
+{
+	const auto& info = get_pixel_format_info(fb.format());
+
+	frame.num_planes = fb.num_planes();
+	frame.size = 0;
+
+	for (unsigned p = 0; p < frame.num_planes; ++p) {
+		frame.plane_offsets[p] = frame.size;
+		frame.plane_sizes[p] = (size_t)fb.stride(p) * (fb.height() / info.planes[p].vsub);
+		frame.size += frame.plane_sizes[p];
+	}
+}
+
+static size_t get_data_offset(const string& key)
+{
+	size_t header_size = sizeof(frame_file_magic) + sizeof(uint32_t) + key.size();
+
+	return (header_size + frame_data_align - 1) / frame_data_align * frame_data_align;
+}
+
+TestPatternCache::TestPatternCache(size_t max_bytes, const string& dir)
+	: m_max_bytes(max_bytes), m_dir(dir)
+{
+	if (!m_dir.empty()) {
+		struct stat st;
+
+		if (stat(m_dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+			throw invalid_argument(fmt::format("Not a directory: {}", m_dir));
+	}
+}
+
+TestPatternCache::~TestPatternCache()
+{
+}
+
+void TestPatternCache::clear()
+{
+	lock_guard lock(m_mutex);
+
+	m_frames.clear();
+	m_lru.clear();
+	m_bytes = 0;
+}
+
+size_t TestPatternCache::size_bytes() const
+{
+	lock_guard lock(m_mutex);
+
+	return m_bytes;
+}
+
+size_t TestPatternCache::hits() const
+{
+	lock_guard lock(m_mutex);
+
+	return m_hits;
+}
+
+size_t TestPatternCache::misses() const
+{
+	lock_guard lock(m_mutex);
+
+	return m_misses;
+}
+
+string TestPatternCache::file_path(const string& key) const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : key) {
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+
+	return fmt::format("{}/kmsxx-testpat-{:016x}.frame", m_dir, hash);
+}
+
+shared_ptr<TestPatternCache::Frame> TestPatternCache::find(const string& key)
+{
+	lock_guard lock(m_mutex);
+
+	auto it = m_frames.find(key);
+	if (it == m_frames.end())
+		return nullptr;
+
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+	return it->second->second;
+}
+
+void TestPatternCache::insert(const string& key, shared_ptr<Frame> frame)
+{
+	lock_guard lock(m_mutex);
+
+	// Frames larger than the whole cache are not kept
+	if (frame->size > m_max_bytes || m_frames.count(key))
+		return;
+
+	while (m_bytes + frame->size > m_max_bytes) {
+		auto& last = m_lru.back();
+		m_bytes -= last.second->size;
+		m_frames.erase(last.first);
+		m_lru.pop_back();
+	}
+
+	m_lru.emplace_front(key, frame);
+	m_frames[key] = m_lru.begin();
+	m_bytes += frame->size;
+}
+
+// Map a frame stored by an earlier draw. A missing or mismatching file is a cache miss.
+shared_ptr<TestPatternCache::Frame> TestPatternCache::load(IFramebuffer& fb, const string& key)
+{
+	int fd = open(file_path(key).c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	int r = fstat(fd, &st);
+
+	void* mapping = r == 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) :
+				 MAP_FAILED;
+
+	close(fd);
+
+	if (mapping == MAP_FAILED)
+		return nullptr;
+
+	auto frame = make_shared<Frame>();
+	frame->mapping = mapping;
+	frame->mapping_size = st.st_size;
+
+	get_plane_layout(fb, *frame);
+
+	const uint8_t* header = (const uint8_t*)mapping;
+	const size_t data_offset = get_data_offset(key);
+	uint32_t key_size;
+
+	if ((size_t)st.st_size < data_offset + frame->size ||
+	    memcmp(header, frame_file_magic, sizeof(frame_file_magic)) != 0)
+		return nullptr;
+
+	memcpy(&key_size, header + sizeof(frame_file_magic), sizeof(key_size));
+
+	if (key_size != key.size() ||
+	    memcmp(header + sizeof(frame_file_magic) + sizeof(key_size), key.data(), key_size) != 0)
+		return nullptr;
+
+	frame->data = (uint8_t*)mapping + data_offset;
+
+	return frame;
+}
+
+shared_ptr<TestPatternCache::Frame> TestPatternCache::render(IFramebuffer& fb, const string& key,
+							     const TestPatternOptions& options)
+{
+	auto frame = make_shared<Frame>();
+
+	get_plane_layout(fb, *frame);
+
+	if (m_dir.empty()) {
+		frame->memory.resize(frame->size);
+		frame->data = frame->memory.data();
+	} else {
+		// Render to a temporary file, and rename it when complete, so that other
+		// processes never see partial frames
+		const string path = file_path(key);
+		const string tmp_path = fmt::format("{}.{}", path, getpid());
+		const size_t data_offset = get_data_offset(key);
+
+		frame->mapping_size = data_offset + frame->size;
+
+		int fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			throw system_error(errno, generic_category(), "Failed to create " + tmp_path);
+
+		if (ftruncate(fd, frame->mapping_size) != 0) {
+			int e = errno;
+			close(fd);
+			unlink(tmp_path.c_str());
+			throw system_error(e, generic_category(), "Failed to resize " + tmp_path);
+		}
+
+		void* mapping = mmap(nullptr, frame->mapping_size, PROT_READ | PROT_WRITE,
+				     MAP_SHARED, fd, 0);
+		int e = errno;
+
+		close(fd);
+
+		if (mapping == MAP_FAILED) {
+			unlink(tmp_path.c_str());
+			throw system_error(e, generic_category(), "Failed to map " + tmp_path);
+		}
+
+		frame->mapping = mapping;
+		frame->data = (uint8_t*)mapping + data_offset;
+
+		uint8_t* header = (uint8_t*)mapping;
+		uint32_t key_size = key.size();
+
+		memcpy(header, frame_file_magic, sizeof(frame_file_magic));
+		memcpy(header + sizeof(frame_file_magic), &key_size, sizeof(key_size));
+		memcpy(header + sizeof(frame_file_magic) + sizeof(key_size), key.data(), key_size);
+
+		draw_frame(fb, *frame, options);
+
+		if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+			e = errno;
+			unlink(tmp_path.c_str());
+			throw system_error(e, generic_category(), "Failed to rename " + tmp_path);
+		}
+
+		return frame;
+	}
+
+	draw_frame(fb, *frame, options);
+
+	return frame;
+}
+
+void TestPatternCache::draw_frame(IFramebuffer& fb, Frame& frame,
+				  const TestPatternOptions& options)
+{
+	uint8_t* buffers[4] {};
+	uint32_t sizes[4] {};
+	uint32_t pitches[4] {};
+	uint32_t offsets[4] {};
+
+	for (unsigned p = 0; p < frame.num_planes; ++p) {
+		buffers[p] = frame.data + frame.plane_offsets[p];
+		sizes[p] = frame.plane_sizes[p];
+		pitches[p] = fb.stride(p);
+	}
+
+	ExtCPUFramebuffer frame_fb(fb.width(), fb.height(), fb.format(), buffers, sizes, pitches,
+				   offsets);
+
+	TestPatternOptions draw_options = options;
+	draw_options.cache = nullptr;
+
+	draw_test_pattern(frame_fb, draw_options);
+}
+
+void TestPatternCache::copy_frame(const Frame& frame, IFramebuffer& fb,
+				  const TestPatternOptions& options)
+{
+	// A chunk of rows. Only the pixels of the rows are copied, leaving the
+	// padding at the end of the rows of fb as it is.
+	struct Chunk {
+		uint8_t* dst;
+		const uint8_t* src;
+		size_t rows;
+		size_t stride;
+		size_t row_bytes;
+	};
+
+	const auto& info = get_pixel_format_info(fb.format());
+
+	vector<Chunk> chunks;
+
+	// Create the mmaps before starting the threads
+	for (unsigned p = 0; p < frame.num_planes; ++p) {
+		uint8_t* dst = fb.map(p);
+		const uint8_t* src = frame.data + frame.plane_offsets[p];
+		const size_t stride = fb.stride(p);
+		const size_t row_bytes = info.stride(fb.width(), p);
+		const size_t num_rows = frame.plane_sizes[p] / stride;
+		const size_t chunk_rows = max<size_t>(copy_chunk_size / stride, 1);
+
+		for (size_t y = 0; y < num_rows; y += chunk_rows)
+			chunks.push_back({ dst + y * stride, src + y * stride,
+					   min(chunk_rows, num_rows - y), stride, row_bytes });
+	}
+
+	const bool write_combined = fb.cpu_caching() == CpuCaching::WriteCombined;
+
+	auto pool = ThreadPool::get_shared(options.num_threads, options.cpus);
+
+	pool->run(chunks.size(), [&chunks, write_combined](size_t i) {
+		const Chunk& c = chunks[i];
+
+		// Without padding, the rows are copied as one
+		const size_t rows = c.row_bytes == c.stride ? 1 : c.rows;
+		const size_t len = c.row_bytes == c.stride ? c.rows * c.stride : c.row_bytes;
+
+		for (size_t y = 0; y < rows; ++y) {
+			if (write_combined)
+				stream_copy(c.dst + y * c.stride, c.src + y * c.stride, len);
+			else
+				memcpy(c.dst + y * c.stride, c.src + y * c.stride, len);
+		}
+	});
+}
+
+void TestPatternCache::draw(IFramebuffer& fb, const TestPatternOptions& options)
+{
+	const string key = make_key(fb, options);
+
+	shared_ptr<Frame> frame = find(key);
+
+	if (!frame && !m_dir.empty()) {
+		frame = load(fb, key);
+		if (frame)
+			insert(key, frame);
+	}
+
+	if (frame) {
+		lock_guard lock(m_mutex);
+		m_hits++;
+	} else {
+		frame = render(fb, key, options);
+		insert(key, frame);
+
+		lock_guard lock(m_mutex);
+		m_misses++;
+	}
+
+	copy_frame(*frame, fb, options);
+}
+
+} // namespace kms
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <kms++/kms++.h>
+#include <kms++util/kms++util.h>
+#include <kms++util/textrenderer.h>
+
+#include "conv-store.h"
+
+using namespace std;
+
+namespace kms
+{
+static bool get_char_pixel(uint8_t c, uint32_t x, uint32_t y)
+{
+#include "font_8x8.h"
+
+	uint8_t bits = fontdata_8x8[8 * c + y];
+	bool bit = (bits >> (7 - x)) & 1;
+
+	return bit;
+}
+
+// Draw the glyph of c scaled by scale, with its top left corner at xpos, ypos
+static void draw_glyph(IFramebuffer& buf, uint32_t xpos, uint32_t ypos, uint8_t c, RGB fg, RGB bg,
+		       unsigned scale)
+{
+	const uint32_t size = 8 * scale;
+
+	auto get_pixel = [c, scale](uint32_t x, uint32_t y) {
+		return get_char_pixel(c, x / scale, y / scale);
+	};
+
+	unsigned x, y;
+	YUV yuv_fg = fg.yuv();
+	YUV yuv_bg = bg.yuv();
+
+	switch (buf.format()) {
+	case PixelFormat::XRGB8888:
+	case PixelFormat::XBGR8888:
+	case PixelFormat::ARGB8888:
+	case PixelFormat::ABGR8888:
+	case PixelFormat::RGB888:
+	case PixelFormat::BGR888:
+	case PixelFormat::RGB565:
+	case PixelFormat::BGR565:
+	case PixelFormat::XRGB4444:
+	case PixelFormat::XRGB1555:
+	case PixelFormat::ARGB4444:
+	case PixelFormat::ARGB1555:
+	case PixelFormat::RGB332:
+		for (y = 0; y < size; y++) {
+			for (x = 0; x < size; x++) {
+				bool b = get_pixel(x, y);
+
+				draw_rgb_pixel(buf, xpos + x, ypos + y, b ? fg : bg);
+			}
+		}
+		break;
+
+	case PixelFormat::YUV444:
+	case PixelFormat::YVU444:
+		for (y = 0; y < size; y++) {
+			for (x = 0; x < size; x++) {
+				bool b = get_pixel(x, y);
+
+				draw_yuv444_pixel(buf, xpos + x, ypos + y, b ? yuv_fg : yuv_bg);
+			}
+		}
+		break;
+
+	case PixelFormat::UYVY:
+	case PixelFormat::YUYV:
+	case PixelFormat::YVYU:
+	case PixelFormat::VYUY:
+	case PixelFormat::NV16:
+	case PixelFormat::NV61:
+	case PixelFormat::YUV422:
+	case PixelFormat::YVU422:
+		for (y = 0; y < size; y++) {
+			for (x = 0; x < size; x += 2) {
+				bool b0 = get_pixel(x, y);
+				bool b1 = get_pixel(x + 1, y);
+
+				draw_yuv422_macropixel(buf, xpos + x, ypos + y,
+						       b0 ? yuv_fg : yuv_bg, b1 ? yuv_fg : yuv_bg);
+			}
+		}
+		break;
+
+	case PixelFormat::NV12:
+	case PixelFormat::NV21:
+	case PixelFormat::YUV420:
+	case PixelFormat::YVU420:
+		for (y = 0; y < size; y += 2) {
+			for (x = 0; x < size; x += 2) {
+				bool b00 = get_pixel(x, y);
+				bool b10 = get_pixel(x + 1, y);
+				bool b01 = get_pixel(x, y + 1);
+				bool b11 = get_pixel(x + 1, y + 1);
+
+				draw_yuv420_macropixel(buf, xpos + x, ypos + y,
+						       b00 ? yuv_fg : yuv_bg, b10 ? yuv_fg : yuv_bg,
+						       b01 ? yuv_fg : yuv_bg, b11 ? yuv_fg : yuv_bg);
+			}
+		}
+		break;
+	default:
+		throw std::invalid_argument("draw_glyph: unknown pixelformat");
+	}
+}
+
+TextRenderer::TextRenderer(PixelFormat format, RGB fg, RGB bg, unsigned scale)
+	: m_fg(fg), m_bg(bg), m_scale(scale), m_glyph_size(8 * scale),
+	  m_atlas(256 * m_glyph_size, m_glyph_size, format)
+{
+	if (scale == 0)
+		throw invalid_argument("TextRenderer: zero scale");
+
+	Canvas canvas(m_atlas);
+
+	m_unit_width = canvas.unit_width();
+	m_unit_rows = canvas.unit_rows();
+
+	for (unsigned c = 0; c < 256; ++c)
+		draw_glyph(m_atlas, c * m_glyph_size, 0, c, fg, bg, scale);
+}
+
+void TextRenderer::draw(IFramebuffer& fb, uint32_t x, uint32_t y, const string& str)
+{
+	if (fb.format() != format())
+		throw invalid_argument("TextRenderer: framebuffer format differs from the atlas");
+
+	x = x / m_unit_width * m_unit_width;
+	y = y / m_unit_rows * m_unit_rows;
+
+	if (x >= fb.width() || y + m_glyph_size > fb.height())
+		return;
+
+	const size_t num_glyphs = min<size_t>(str.size(), (fb.width() - x) / m_glyph_size);
+	if (num_glyphs == 0)
+		return;
+
+	add_damage(fb, { x, y, (uint32_t)num_glyphs * m_glyph_size, m_glyph_size });
+
+	const PixelFormatInfo& info = get_pixel_format_info(fb.format());
+	const bool write_combined = fb.cpu_caching() == CpuCaching::WriteCombined;
+
+	for (unsigned p = 0; p < fb.num_planes(); ++p) {
+		const uint32_t vsub = info.planes[p].vsub;
+		const size_t glyph_bytes = info.stride(m_glyph_size, p);
+		const size_t offset = info.stride(x, p);
+
+		for (uint32_t r = 0; r < m_glyph_size / vsub; ++r) {
+			const uint8_t* src = m_atlas.map(p) + r * m_atlas.stride(p);
+			uint8_t* dst = fb.map(p) + (y / vsub + r) * fb.stride(p) + offset;
+
+			if (!write_combined) {
+				for (size_t i = 0; i < num_glyphs; ++i)
+					memcpy(dst + i * glyph_bytes,
+					       src + (uint8_t)str[i] * glyph_bytes, glyph_bytes);
+				continue;
+			}
+
+			// Gather the row of the glyphs for full line stores
+			m_span.resize(num_glyphs * glyph_bytes);
+
+			for (size_t i = 0; i < num_glyphs; ++i)
+				memcpy(m_span.data() + i * glyph_bytes,
+				       src + (uint8_t)str[i] * glyph_bytes, glyph_bytes);
+
+			stream_copy(dst, m_span.data(), m_span.size());
+		}
+	}
+}
+
+} // namespace kms
@@ -0,0 +1,259 @@
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#ifdef HAS_PTHREAD
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <kms++util/threadpool.h>
+
+using namespace std;
+
+namespace kms
+{
+// The pool whose tasks the thread is running, if any: set for the workers, and for
+// a thread while it takes part in its run()
+static thread_local const ThreadPool* t_current_pool;
+
+// Without threads, the pool has no workers and run() runs the tasks in the
+// calling thread
+static unsigned pool_threads(unsigned num_threads)
+{
+#ifdef HAS_PTHREAD
+	return num_threads ? num_threads : max(thread::hardware_concurrency(), 1u);
+#else
+	return 1;
+#endif
+}
+
+ThreadPool::ThreadPool(unsigned num_threads, const vector<unsigned>& cpus)
+	: m_num_threads(pool_threads(num_threads)),
+	  m_cpus(cpus), m_ranges(make_unique<TaskRange[]>(m_num_threads))
+{
+#ifdef HAS_PTHREAD
+	for (unsigned cpu : m_cpus) {
+		if (cpu >= CPU_SETSIZE)
+			throw invalid_argument("Bad CPU number for thread affinity");
+	}
+
+	// The calling thread is the participant 0, the workers are 1...n-1
+	for (unsigned i = 1; i < m_num_threads; ++i) {
+		m_workers.emplace_back([this, i]() { worker_main(i); });
+
+		if (m_cpus.empty())
+			continue;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(m_cpus[(i - 1) % m_cpus.size()], &set);
+
+		int r = pthread_setaffinity_np(m_workers.back().native_handle(), sizeof(set), &set);
+		if (r) {
+			stop_workers();
+			throw system_error(r, generic_category(), "Failed to set thread affinity");
+		}
+	}
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+	stop_workers();
+}
+
+shared_ptr<ThreadPool> ThreadPool::get_shared(unsigned num_threads, const vector<unsigned>& cpus)
+{
+	static mutex pool_mutex;
+	static shared_ptr<ThreadPool> pool;
+
+	num_threads = pool_threads(num_threads);
+
+	lock_guard lock(pool_mutex);
+
+	if (!pool || pool->num_threads() != num_threads || pool->cpus() != cpus)
+		pool = make_shared<ThreadPool>(num_threads, cpus);
+
+	return pool;
+}
+
+void ThreadPool::stop_workers()
+{
+	{
+		lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_start_cv.notify_all();
+
+	for (thread& t : m_workers)
+		t.join();
+
+	m_workers.clear();
+}
+
+void ThreadPool::run(size_t num_tasks, const function<void(size_t task)>& func)
+{
+	if (num_tasks == 0)
+		return;
+
+	// A run() from one of our tasks would wait for the workers busy with the
+	// outer run(), so the nested tasks are run in the calling thread
+	if (m_workers.empty() || t_current_pool == this) {
+		for (size_t i = 0; i < num_tasks; ++i)
+			func(i);
+		return;
+	}
+
+	lock_guard run_lock(m_run_mutex);
+
+	struct CurrentPool {
+		const ThreadPool* prev;
+
+		CurrentPool(const ThreadPool* pool) : prev(exchange(t_current_pool, pool)) {}
+		~CurrentPool() { t_current_pool = prev; }
+	} current_pool(this);
+
+	// Give each thread an equal, contiguous part of the tasks
+	for (unsigned i = 0; i < m_num_threads; ++i) {
+		lock_guard lock(m_ranges[i].mutex);
+		m_ranges[i].begin = num_tasks * i / m_num_threads;
+		m_ranges[i].end = num_tasks * (i + 1) / m_num_threads;
+	}
+
+	{
+		lock_guard lock(m_mutex);
+		m_func = &func;
+		m_error = nullptr;
+		m_failed = false;
+		m_busy_workers = m_workers.size();
+		m_generation++;
+	}
+
+	m_start_cv.notify_all();
+
+	run_tasks(0);
+
+	unique_lock lock(m_mutex);
+	m_done_cv.wait(lock, [this]() { return m_busy_workers == 0; });
+
+	m_func = nullptr;
+
+	if (m_error)
+		rethrow_exception(exchange(m_error, nullptr));
+}
+
+void ThreadPool::worker_main(unsigned idx)
+{
+	uint64_t generation = 0;
+
+	t_current_pool = this;
+
+	while (true) {
+		{
+			unique_lock lock(m_mutex);
+			m_start_cv.wait(lock, [&]() { return m_stop || m_generation != generation; });
+
+			if (m_stop)
+				return;
+
+			generation = m_generation;
+		}
+
+		run_tasks(idx);
+
+		bool last;
+
+		{
+			lock_guard lock(m_mutex);
+			last = --m_busy_workers == 0;
+		}
+
+		if (last)
+			m_done_cv.notify_one();
+	}
+}
+
+void ThreadPool::run_tasks(unsigned idx)
+{
+	size_t task;
+
+	while (get_task(idx, task)) {
+		try {
+			(*m_func)(task);
+		} catch (...) {
+			lock_guard lock(m_mutex);
+			if (!m_error)
+				m_error = current_exception();
+			m_failed = true;
+		}
+	}
+}
+
+bool ThreadPool::get_task(unsigned idx, size_t& task)
+{
+	TaskRange& range = m_ranges[idx];
+
+	while (!m_failed) {
+		{
+			lock_guard lock(range.mutex);
+			if (range.begin < range.end) {
+				task = range.begin++;
+				return true;
+			}
+		}
+
+		if (!steal_tasks(idx))
+			return false;
+	}
+
+	return false;
+}
+
+// Move the latter half of the largest remaining range to the range of thread idx
+bool ThreadPool::steal_tasks(unsigned idx)
+{
+	while (true) {
+		unsigned victim = idx;
+		size_t max_left = 0;
+
+		for (unsigned i = 0; i < m_num_threads; ++i) {
+			if (i == idx)
+				continue;
+
+			lock_guard lock(m_ranges[i].mutex);
+			size_t left = m_ranges[i].end - m_ranges[i].begin;
+			if (left > max_left) {
+				max_left = left;
+				victim = i;
+			}
+		}
+
+		if (victim == idx)
+			return false;
+
+		TaskRange& from = m_ranges[victim];
+		TaskRange& to = m_ranges[idx];
+
+		// Lock in index order to avoid deadlocks with a concurrent thief
+		unique_lock lock1(victim < idx ? from.mutex : to.mutex);
+		unique_lock lock2(victim < idx ? to.mutex : from.mutex);
+
+		size_t left = from.end - from.begin;
+
+		// The victim made progress while we were looking, try again
+		if (left == 0)
+			continue;
+
+		size_t mid = from.end - (left + 1) / 2;
+
+		to.begin = mid;
+		to.end = from.end;
+		from.end = mid;
+
+		return true;
+	}
+}
+
+} // namespace kms
@@ -0,0 +1,105 @@
+/*
+ * ColorConverter must give bit-identical results to the double precision
+ * RGB16::to_yuv() and YUV16::to_rgb(). Every 8-bit expanded input and a sample
+ * of 16-bit inputs are checked in both directions, for every standard and range.
+ */
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <kms++util/color16.h>
+
+using namespace std;
+using namespace kms;
+
+static unsigned s_failures;
+
+static void check(const ColorConverter& conv, uint16_t c0, uint16_t c1, uint16_t c2)
+{
+	const RGB16 rgb(c0, c1, c2);
+	const YUV16 yuv_ref = rgb.to_yuv(conv.rec(), conv.range());
+	const YUV16 yuv = conv.to_yuv(rgb);
+
+	if (yuv.y != yuv_ref.y || yuv.u != yuv_ref.u || yuv.v != yuv_ref.v) {
+		if (s_failures++ < 10)
+			fmt::print(stderr, "to_yuv({:#x}, {:#x}, {:#x}): {:#x} {:#x} {:#x}, expected {:#x} {:#x} {:#x}\n",
+				   c0, c1, c2, yuv.y, yuv.u, yuv.v, yuv_ref.y, yuv_ref.u, yuv_ref.v);
+	}
+
+	const YUV16 yuv_in(c0, c1, c2);
+	const RGB16 rgb_ref = yuv_in.to_rgb(conv.rec(), conv.range());
+	const RGB16 rgb_out = conv.to_rgb(yuv_in);
+
+	if (rgb_out.r != rgb_ref.r || rgb_out.g != rgb_ref.g || rgb_out.b != rgb_ref.b) {
+		if (s_failures++ < 10)
+			fmt::print(stderr, "to_rgb({:#x}, {:#x}, {:#x}): {:#x} {:#x} {:#x}, expected {:#x} {:#x} {:#x}\n",
+				   c0, c1, c2, rgb_out.r, rgb_out.g, rgb_out.b, rgb_ref.r, rgb_ref.g,
+				   rgb_ref.b);
+	}
+}
+
+// The line variants convert runs once, and must match the pixel variants
+static void check_lines(const ColorConverter& conv, mt19937& rng)
+{
+	vector<RGB16> rgb(1024);
+	vector<YUV16> yuv(rgb.size());
+	vector<RGB16> rgb_out(rgb.size());
+
+	for (size_t x = 0; x < rgb.size(); ++x) {
+		// Runs of a few pixels, starting with black to hit the initial run
+		if (x > 0 && rng() % 4 == 0)
+			rgb[x] = RGB16(rng(), rng(), rng());
+		else if (x > 0)
+			rgb[x] = rgb[x - 1];
+	}
+
+	conv.to_yuv(rgb, yuv);
+	conv.to_rgb(yuv, rgb_out);
+
+	for (size_t x = 0; x < rgb.size(); ++x) {
+		const YUV16 y = conv.to_yuv(rgb[x]);
+		const RGB16 r = conv.to_rgb(yuv[x]);
+
+		if (yuv[x].y != y.y || yuv[x].u != y.u || yuv[x].v != y.v ||
+		    rgb_out[x].r != r.r || rgb_out[x].g != r.g || rgb_out[x].b != r.b) {
+			if (s_failures++ < 10)
+				fmt::print(stderr, "line conversion differs at {}\n", x);
+		}
+	}
+}
+
+int main()
+{
+	const RecStandard recs[] = { RecStandard::BT601, RecStandard::BT709, RecStandard::BT2020 };
+	const ColorRange ranges[] = { ColorRange::Limited, ColorRange::Full };
+
+	mt19937 rng(1234);
+
+	for (RecStandard rec : recs) {
+		for (ColorRange range : ranges) {
+			const ColorConverter& conv = ColorConverter::get(rec, range);
+
+			for (unsigned c0 = 0; c0 < 256; ++c0) {
+				for (unsigned c1 = 0; c1 < 256; ++c1) {
+					for (unsigned c2 = 0; c2 < 256; ++c2)
+						check(conv, c0 * 0x101, c1 * 0x101, c2 * 0x101);
+				}
+			}
+
+			for (unsigned i = 0; i < 1000000; ++i)
+				check(conv, rng(), rng(), rng());
+
+			check_lines(conv, rng);
+		}
+	}
+
+	if (s_failures) {
+		fmt::print(stderr, "{} mismatches\n", s_failures);
+		return 1;
+	}
+
+	return 0;
+}
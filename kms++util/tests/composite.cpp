@@ -0,0 +1,217 @@
+/*
+ * A single opaque layer covering the whole destination must composite to the same
+ * pixels as convert_framebuffer(). Every RGB layer format is checked, including the
+ * 24-bit formats.
+ *
+ * A scaled layer over another, partly outside the destination, must match a
+ * reference made with scale_framebuffer() and the scalar blend_pixel(), for an
+ * opaque layer of each format, and for an ARGB layer with a plane alpha in each
+ * blend mode.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <kms++/kms++.h>
+#include <kms++util/kms++util.h>
+
+#include "conv-blend.h"
+
+using namespace std;
+using namespace kms;
+
+static unsigned s_failures;
+
+static bool same_pixels(CPUFramebuffer& a, CPUFramebuffer& b)
+{
+	const size_t row_bytes = get_pixel_format_info(a.format()).stride(a.width());
+
+	for (unsigned y = 0; y < a.height(); ++y) {
+		if (memcmp(a.map(0) + y * a.stride(0), b.map(0) + y * b.stride(0), row_bytes))
+			return false;
+	}
+
+	return true;
+}
+
+// Composite top over bottom, a layer covering the destination, by scaling top with
+// scale_framebuffer() and blending it with blend_pixel()
+static vector<RGB16> reference_composite(IFramebuffer& bottom, const CompositeLayer& top,
+					 bool opaque)
+{
+	const uint32_t width = bottom.width();
+	const uint32_t height = bottom.height();
+
+	vector<RGB16> pixels(width * height);
+	read_framebuffer(bottom, 0, height - 1, span(pixels));
+
+	CPUFramebuffer scaled(top.dst_w, top.dst_h, PixelFormat::ARGB8888);
+	scale_framebuffer(*top.fb, scaled);
+
+	vector<RGB16> layer(top.dst_w * top.dst_h);
+	read_framebuffer(scaled, 0, top.dst_h - 1, span(layer));
+
+	for (uint32_t y = 0; y < top.dst_h; ++y) {
+		const int64_t dst_y = top.dst_y + (int64_t)y;
+
+		if (dst_y < 0 || dst_y >= height)
+			continue;
+
+		for (uint32_t x = 0; x < top.dst_w; ++x) {
+			const int64_t dst_x = top.dst_x + (int64_t)x;
+
+			if (dst_x < 0 || dst_x >= width)
+				continue;
+
+			RGB16 src = layer[y * top.dst_w + x];
+			RGB16& dst = pixels[dst_y * width + dst_x];
+
+			// The 8-bit alpha reads as 0xab00, widen it as the compositor does
+			src.a |= src.a >> 8;
+
+			if (opaque)
+				dst = src;
+			else
+				blend_pixel(reinterpret_cast<uint16_t*>(&dst),
+					    reinterpret_cast<const uint16_t*>(&src), top.alpha,
+					    top.blend_mode);
+		}
+	}
+
+	return pixels;
+}
+
+// Compare the 8-bit components of dst to the reference. The reference's scaled layer
+// is 8-bit, so blended pixels may be one step off.
+static bool matches_reference(IFramebuffer& dst, const vector<RGB16>& ref, int tolerance)
+{
+	vector<RGB16> pixels(dst.width() * dst.height());
+	read_framebuffer(dst, 0, dst.height() - 1, span(pixels));
+
+	auto close = [tolerance](uint16_t a, uint16_t b) {
+		return abs((a >> 8) - (b >> 8)) <= tolerance;
+	};
+
+	for (size_t i = 0; i < pixels.size(); ++i) {
+		if (!close(pixels[i].r, ref[i].r) || !close(pixels[i].g, ref[i].g) ||
+		    !close(pixels[i].b, ref[i].b))
+			return false;
+	}
+
+	return true;
+}
+
+static void check_format(PixelFormat format)
+{
+	const uint32_t width = 192;
+	const uint32_t height = 96;
+
+	CPUFramebuffer src(width, height, format);
+	CPUFramebuffer ref(width, height, PixelFormat::XRGB8888);
+	CPUFramebuffer dst(width, height, PixelFormat::XRGB8888);
+
+	draw_test_pattern_single(src);
+	convert_framebuffer(src, ref);
+
+	CompositeLayer layer;
+	layer.fb = &src;
+
+	composite_framebuffers(span(&layer, 1), dst);
+
+	if (!same_pixels(ref, dst)) {
+		fmt::print(stderr, "{}: composite differs from convert\n",
+			   get_pixel_format_info(format).name);
+		s_failures++;
+	}
+
+	// A scaled opaque layer over another, partly outside the destination
+	CompositeLayer layers[2];
+	layers[0].fb = &src;
+	layers[1].fb = &src;
+	layers[1].dst_x = width / 2;
+	layers[1].dst_y = -(int32_t)height / 4;
+	layers[1].dst_w = width / 3;
+	layers[1].dst_h = height / 3;
+	layers[1].zpos = 1;
+	layers[1].blend_mode = BlendMode::None;
+
+	composite_framebuffers(layers, dst);
+
+	if (!matches_reference(dst, reference_composite(src, layers[1], true), 0)) {
+		fmt::print(stderr, "{}: scaled composite differs from the reference\n",
+			   get_pixel_format_info(format).name);
+		s_failures++;
+	}
+}
+
+static void check_blend_mode(BlendMode mode)
+{
+	const uint32_t width = 192;
+	const uint32_t height = 96;
+
+	CPUFramebuffer bottom(width, height, PixelFormat::XRGB8888);
+	CPUFramebuffer top(width / 2, height / 2, PixelFormat::ARGB8888);
+	CPUFramebuffer dst(width, height, PixelFormat::XRGB8888);
+
+	draw_test_pattern_single(bottom);
+
+	// Gradients, with the pixel alpha going from transparent to opaque
+	for (uint32_t y = 0; y < top.height(); ++y) {
+		uint32_t* row = reinterpret_cast<uint32_t*>(top.map(0) + y * top.stride(0));
+
+		for (uint32_t x = 0; x < top.width(); ++x) {
+			const uint32_t a = x * 255 / (top.width() - 1);
+			const uint32_t r = y * 255 / (top.height() - 1);
+
+			row[x] = a << 24 | r << 16 | (255 - r) << 8 | (x * 5 & 0xff);
+		}
+	}
+
+	CompositeLayer layers[2];
+	layers[0].fb = &bottom;
+	layers[1].fb = &top;
+	layers[1].dst_x = -(int32_t)width / 8;
+	layers[1].dst_y = height / 3;
+	layers[1].dst_w = width * 2 / 3;
+	layers[1].dst_h = height * 3 / 4;
+	layers[1].zpos = 1;
+	layers[1].alpha = 0x9000;
+	layers[1].blend_mode = mode;
+
+	composite_framebuffers(layers, dst);
+
+	if (!matches_reference(dst, reference_composite(bottom, layers[1], false), 1)) {
+		fmt::print(stderr, "blend mode {}: composite differs from the reference\n",
+			   (int)mode);
+		s_failures++;
+	}
+}
+
+int main()
+{
+	const PixelFormat formats[] = {
+		PixelFormat::RGB888, PixelFormat::BGR888, PixelFormat::XRGB8888,
+		PixelFormat::ARGB8888, PixelFormat::RGB565, PixelFormat::XRGB2101010,
+	};
+
+	for (PixelFormat format : formats) {
+		if (!test_pattern_supports_format(format))
+			continue;
+
+		check_format(format);
+	}
+
+	for (BlendMode mode : { BlendMode::None, BlendMode::Premultiplied, BlendMode::Coverage })
+		check_blend_mode(mode);
+
+	if (s_failures) {
+		fmt::print(stderr, "{} mismatches\n", s_failures);
+		return 1;
+	}
+
+	return 0;
+}
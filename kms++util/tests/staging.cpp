@@ -0,0 +1,124 @@
+/*
+ * Rows of a write-combined framebuffer are drawn through a cached staging buffer.
+ * The staged rows must still take the line span path of a generator that describes
+ * its lines, must match the rows drawn directly, and the stride padding of the
+ * framebuffer must be left untouched.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <kms++/kms++.h>
+#include <kms++util/kms++util.h>
+
+#include "conv-write.h"
+
+using namespace std;
+using namespace kms;
+
+static unsigned s_failures;
+
+class WriteCombinedFramebuffer : public ExtCPUFramebuffer
+{
+public:
+	using ExtCPUFramebuffer::ExtCPUFramebuffer;
+
+	CpuCaching cpu_caching() const override { return CpuCaching::WriteCombined; }
+};
+
+// A solid left half and a ramp on the right half, counting how the lines are drawn
+struct SpanGenerator {
+	mutable unsigned num_lines = 0;
+	mutable unsigned num_described = 0;
+
+	void operator()(size_t y, span<RGB16> line) const
+	{
+		num_lines++;
+
+		LineSpans<RGB16> spans;
+		fill(y, line, spans);
+		expand_line_spans(spans, line);
+	}
+
+	void describe_line(size_t y, span<RGB16> line, LineSpans<RGB16>& spans) const
+	{
+		num_described++;
+		fill(y, line, spans);
+	}
+
+	static void fill(size_t y, span<RGB16> line, LineSpans<RGB16>& spans)
+	{
+		const size_t half = line.size() / 2;
+
+		add_solid_span(spans, 0, half, RGB16(y * 0x100, 0x8000, 0xffff));
+
+		for (size_t x = half; x < line.size(); ++x)
+			line[x] = RGB16(x * 0x100, y * 0x100, 0);
+
+		spans.push_back({ half, line.size(), false, {} });
+	}
+};
+
+static void check_format(PixelFormat format)
+{
+	const uint32_t width = 192;
+	const uint32_t height = 96;
+	const auto& info = get_pixel_format_info(format);
+	const uint32_t row_bytes = info.stride(width);
+	const uint32_t pitch = row_bytes + 64;
+
+	CPUFramebuffer ref(width, height, format);
+
+	vector<uint8_t> buf(pitch * height, 0xa5);
+	WriteCombinedFramebuffer fb(width, height, format, buf.data(), buf.size(), pitch, 0);
+
+	auto no_yuv = [](size_t y, span<YUV16> line) {};
+
+	SpanGenerator ref_gen;
+	write_pattern_lines(ref, 0, height - 1, ref_gen, no_yuv);
+
+	SpanGenerator gen;
+	write_pattern_lines(fb, 0, height - 1, gen, no_yuv);
+
+	if (gen.num_lines != 0 || gen.num_described != height) {
+		fmt::print(stderr, "{}: {} lines generated and {} described, expected 0 and {}\n",
+			   info.name, gen.num_lines, gen.num_described, height);
+		s_failures++;
+	}
+
+	for (unsigned y = 0; y < height; ++y) {
+		const uint8_t* row = buf.data() + y * pitch;
+
+		if (memcmp(row, ref.map(0) + y * ref.stride(0), row_bytes)) {
+			fmt::print(stderr, "{}: row {} differs\n", info.name, y);
+			s_failures++;
+			return;
+		}
+
+		for (uint32_t x = row_bytes; x < pitch; ++x) {
+			if (row[x] != 0xa5) {
+				fmt::print(stderr, "{}: stride padding of row {} overwritten\n",
+					   info.name, y);
+				s_failures++;
+				return;
+			}
+		}
+	}
+}
+
+int main()
+{
+	check_format(PixelFormat::XRGB8888);
+	check_format(PixelFormat::RGB888);
+	check_format(PixelFormat::RGB565);
+
+	if (s_failures) {
+		fmt::print(stderr, "{} mismatches\n", s_failures);
+		return 1;
+	}
+
+	return 0;
+}
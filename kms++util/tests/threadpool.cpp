@@ -0,0 +1,88 @@
+/*
+ * ThreadPool::run() must run every task once, rethrow a task's exception, and run
+ * the tasks of a run() made from within a task of the same pool instead of
+ * deadlocking.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <kms++util/threadpool.h>
+
+using namespace std;
+using namespace kms;
+
+static unsigned s_failures;
+
+static void check_run(ThreadPool& pool)
+{
+	const size_t num_tasks = 1000;
+	vector<atomic<unsigned>> counts(num_tasks);
+
+	pool.run(num_tasks, [&](size_t task) { counts[task]++; });
+
+	for (size_t i = 0; i < num_tasks; ++i) {
+		if (counts[i] != 1) {
+			fmt::print(stderr, "{} threads: task {} ran {} times\n", pool.num_threads(), i,
+				   counts[i].load());
+			s_failures++;
+			return;
+		}
+	}
+}
+
+static void check_nested_run(ThreadPool& pool)
+{
+	const size_t num_tasks = 16;
+	atomic<unsigned> count = 0;
+
+	pool.run(num_tasks, [&](size_t task) {
+		pool.run(num_tasks, [&](size_t inner_task) { count++; });
+	});
+
+	if (count != num_tasks * num_tasks) {
+		fmt::print(stderr, "{} threads: {} nested tasks ran, expected {}\n", pool.num_threads(),
+			   count.load(), num_tasks * num_tasks);
+		s_failures++;
+	}
+}
+
+static void check_exception(ThreadPool& pool)
+{
+	try {
+		pool.run(100, [](size_t task) {
+			if (task == 42)
+				throw runtime_error("task failed");
+		});
+	} catch (const runtime_error&) {
+		return;
+	}
+
+	fmt::print(stderr, "{} threads: the exception was not rethrown\n", pool.num_threads());
+	s_failures++;
+}
+
+int main()
+{
+	for (unsigned num_threads : { 1, 2, 4, 8 }) {
+		ThreadPool pool(num_threads);
+
+		check_run(pool);
+		check_nested_run(pool);
+		check_exception(pool);
+
+		// The pool is still usable after a failed run
+		check_run(pool);
+	}
+
+	if (s_failures) {
+		fmt::print(stderr, "{} failures\n", s_failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -26,6 +26,11 @@ void init_pykmsbase(py::module& m)
 		.def_property_readonly("fd", &Card::fd)
 		.def_property_readonly("minor", &Card::dev_minor)
 		.def_property_readonly("get_first_connected_connector", &Card::get_first_connected_connector)
+		.def(
+			"probe_connectors", [](Card* self, const vector<Connector*>& connectors) {
+				self->probe_connectors(connectors);
+			},
+			py::arg("connectors") = vector<Connector*>())
 
 		// XXX pybind11 can't handle vector<T*> where T is non-copyable, and complains:
 		// RuntimeError: return_value_policy = move, but the object is neither movable nor copyable!
@@ -67,8 +72,8 @@ void init_pykmsbase(py::module& m)
 		.def("get_prop_value", (uint64_t(DrmPropObject::*)(const string&) const) & DrmPropObject::get_prop_value)
 		.def("set_prop_value", (int(DrmPropObject::*)(const string&, uint64_t)) & DrmPropObject::set_prop_value)
 		.def("get_prop_value_as_blob", &DrmPropObject::get_prop_value_as_blob)
-		.def("get_prop", &DrmPropObject::get_prop)
-		.def("has_prop", &DrmPropObject::has_prop);
+		.def("get_prop", (Property * (DrmPropObject::*)(const string&) const) & DrmPropObject::get_prop)
+		.def("has_prop", (bool(DrmPropObject::*)(const string&) const) & DrmPropObject::has_prop);
 
 	py::class_<Connector, DrmPropObject, unique_ptr<Connector, py::nodelete>>(m, "Connector")
 		.def_property_readonly("fullname", &Connector::fullname)
@@ -82,7 +87,8 @@ void init_pykmsbase(py::module& m)
 		.def("get_mode", (Videomode(Connector::*)(unsigned xres, unsigned yres, float refresh, bool ilace) const) & Connector::get_mode)
 		.def("connected", &Connector::connected)
 		.def("__repr__", [](const Connector& o) { return "<pykms.Connector " + to_string(o.id()) + ">"; })
-		.def("refresh", &Connector::refresh);
+		.def("refresh", &Connector::refresh)
+		.def("probe", &Connector::probe);
 
 	py::class_<Crtc, DrmPropObject, unique_ptr<Crtc, py::nodelete>>(m, "Crtc")
 		.def("set_mode", (int(Crtc::*)(Connector*, const Videomode&)) & Crtc::set_mode)
@@ -153,6 +159,10 @@ void init_pykmsbase(py::module& m)
 		.def_property_readonly("idx", &DrmObject::idx)
 		.def_property_readonly("card", &DrmObject::card);
 
+	py::enum_<CpuCaching>(m, "CpuCaching")
+		.value("Cached", CpuCaching::Cached)
+		.value("WriteCombined", CpuCaching::WriteCombined);
+
 	py::class_<Framebuffer>(m, "Framebuffer")
 		.def_property_readonly("width", &Framebuffer::width)
 		.def_property_readonly("height", &Framebuffer::height)
@@ -165,6 +175,7 @@ void init_pykmsbase(py::module& m)
 
 		.def("flush", (void(Framebuffer::*)(void)) & Framebuffer::flush)
 		.def("flush", (void(Framebuffer::*)(uint32_t x, uint32_t y, uint32_t width, uint32_t height)) & Framebuffer::flush)
+		.def_property("cpu_caching", &Framebuffer::cpu_caching, &Framebuffer::set_cpu_caching)
 
 		// XXX pybind11 doesn't support a base object (DrmObject) with custom holder-type,
 		// and a subclass with standard holder-type.
@@ -310,6 +321,27 @@ void init_pykmsbase(py::module& m)
 			py::arg("data") = 0, py::arg("allow_modeset") = false)
 		.def("commit_sync", &AtomicReq::commit_sync, py::arg("allow_modeset") = false);
 
+	py::class_<PreparedAtomicReq>(m, "PreparedAtomicReq")
+		.def(py::init<Card&>(),
+		     py::keep_alive<1, 2>()) // Keep Card alive until this is destructed
+		.def("add", (size_t(PreparedAtomicReq::*)(DrmPropObject*, const string&, uint64_t)) & PreparedAtomicReq::add,
+		     py::arg("ob"), py::arg("prop"), py::arg("value") = 0)
+		.def("add", (size_t(PreparedAtomicReq::*)(DrmPropObject*, Property*, uint64_t)) & PreparedAtomicReq::add,
+		     py::arg("ob"), py::arg("prop"), py::arg("value") = 0)
+		.def_property_readonly("num_slots", &PreparedAtomicReq::num_slots)
+		.def("set", &PreparedAtomicReq::set)
+		.def("get", &PreparedAtomicReq::get)
+		.def("set_active", &PreparedAtomicReq::set_active)
+		.def("is_active", &PreparedAtomicReq::is_active)
+		.def("test", &PreparedAtomicReq::test, py::arg("allow_modeset") = false)
+		.def(
+			"commit",
+			[](PreparedAtomicReq* self, uint32_t data, bool allow) {
+				return self->commit((void*)(intptr_t)data, allow);
+			},
+			py::arg("data") = 0, py::arg("allow_modeset") = false)
+		.def("commit_sync", &PreparedAtomicReq::commit_sync, py::arg("allow_modeset") = false);
+
 	py::class_<PixelFormatPlaneInfo>(m, "PixelFormatPlaneInfo")
 		.def_readonly("bytes_per_block", &PixelFormatPlaneInfo::bytes_per_block)
 		.def_readonly("pixels_per_block", &PixelFormatPlaneInfo::pixels_per_block)
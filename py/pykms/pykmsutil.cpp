@@ -59,4 +59,58 @@ void init_pykmsutils(py::module& m)
 		draw_circle(fb, xCenter, yCenter, radius, color);
 	});
 	m.def("draw_text", [](Framebuffer& fb, uint32_t x, uint32_t y, const string& str, RGB color) { draw_text(fb, x, y, str, color); });
+
+	py::class_<Canvas::Color>(m, "CanvasColor");
+
+	py::class_<Canvas>(m, "Canvas")
+		.def(py::init<Framebuffer&>(), py::keep_alive<1, 2>())
+		.def_property_readonly("width", &Canvas::width)
+		.def_property_readonly("height", &Canvas::height)
+		.def("pack", &Canvas::pack)
+		.def("fill_rect", (void (Canvas::*)(int32_t, int32_t, int32_t, int32_t, const Canvas::Color&)) & Canvas::fill_rect)
+		.def("fill_rect", (void (Canvas::*)(int32_t, int32_t, int32_t, int32_t, RGB)) & Canvas::fill_rect)
+		.def("draw_hline", (void (Canvas::*)(int32_t, int32_t, int32_t, const Canvas::Color&)) & Canvas::draw_hline)
+		.def("draw_hline", (void (Canvas::*)(int32_t, int32_t, int32_t, RGB)) & Canvas::draw_hline)
+		.def("draw_line", (void (Canvas::*)(int32_t, int32_t, int32_t, int32_t, const Canvas::Color&)) & Canvas::draw_line)
+		.def("draw_line", (void (Canvas::*)(int32_t, int32_t, int32_t, int32_t, RGB)) & Canvas::draw_line)
+		.def("fill_circle", (void (Canvas::*)(int32_t, int32_t, int32_t, const Canvas::Color&)) & Canvas::fill_circle)
+		.def("fill_circle", (void (Canvas::*)(int32_t, int32_t, int32_t, RGB)) & Canvas::fill_circle);
+
+	py::class_<TextRenderer>(m, "TextRenderer")
+		.def(py::init<PixelFormat, RGB, RGB, unsigned>(),
+		     py::arg("format"),
+		     py::arg("fg"),
+		     py::arg("bg") = RGB(),
+		     py::arg("scale") = 1)
+		.def_property_readonly("glyph_width", &TextRenderer::glyph_width)
+		.def_property_readonly("glyph_height", &TextRenderer::glyph_height)
+		.def("draw", [](TextRenderer& tr, Framebuffer& fb, uint32_t x, uint32_t y, const string& str) {
+			tr.draw(fb, x, y, str);
+		});
+
+	// Returns the rows as bytes, with four native endian uint16 components per pixel:
+	// R, G, B, A for RGB and raw formats, and Y, U, V, A for YUV formats
+	m.def(
+		"read_framebuffer", [](Framebuffer& fb, uint32_t start_y, int32_t end_y, unsigned num_threads) {
+			const uint32_t last_y = end_y < 0 ? fb.height() - 1 : end_y;
+			const size_t num_pixels = (size_t)(last_y - start_y + 1) * fb.width();
+
+			string data;
+
+			if (get_pixel_format_info(fb.format()).type == PixelColorType::YUV) {
+				vector<YUV16> pixels(num_pixels);
+				read_framebuffer(fb, start_y, last_y, pixels, num_threads);
+				data.assign((const char*)pixels.data(), pixels.size() * sizeof(YUV16));
+			} else {
+				vector<RGB16> pixels(num_pixels);
+				read_framebuffer(fb, start_y, last_y, pixels, num_threads);
+				data.assign((const char*)pixels.data(), pixels.size() * sizeof(RGB16));
+			}
+
+			return py::bytes(data);
+		},
+		py::arg("fb"),
+		py::arg("start_y") = 0,
+		py::arg("end_y") = -1,
+		py::arg("num_threads") = 0);
 }
@@ -16,7 +16,7 @@ monitor.filter_by('drm')
 for device in iter(monitor.poll, None):
 	if 'HOTPLUG' in device:
 		print("HPD")
+		card.probe_connectors()
 		for conn in conns:
-			conn.refresh()
 			modes = conn.get_modes()
 			print("  ", conn.fullname, ["{}x{}".format(m.hdisplay, m.vdisplay) for m in modes])
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <kms++/kms++.h>
+#include <kms++/pixelformattable.h>
+#include <kms++util/kms++util.h>
+#include <kms++util/stopwatch.h>
+
+using namespace std;
+using namespace kms;
+
+static const char* usage_str =
+	"Usage: kmsbench [OPTION]...\n\n"
+	"Benchmark drawing the test patterns, and print the results as JSON\n\n"
+	"Options:\n"
+	"  -f, --format=FORMAT       benchmark FORMAT, default all supported formats\n"
+	"  -s, --size=WxH            benchmark size WxH, default 720p, 1080p, 4K and 8K\n"
+	"  -p, --pattern=PATTERN     benchmark PATTERN (solid, default, smpte), default all\n"
+	"  -t, --threads=NUM         benchmark with NUM threads, 0 meaning all CPUs,\n"
+	"                            default 1 and 0\n"
+	"  -i, --iterations=NUM      run at least NUM iterations, default 3\n"
+	"  -m, --min-time=MS         run for at least MS milliseconds, default 100\n"
+	"  -o, --output=FILE         write the JSON to FILE instead of stdout\n"
+	"  -q, --quiet               don't print the progress to stderr\n"
+	"\n"
+	"Options can be given multiple times.\n";
+
+static void usage()
+{
+	puts(usage_str);
+}
+
+// The benchmarked patterns, and their TestPatternOptions pattern
+static const map<string, string> patterns = {
+	{ "solid", "white" },
+	{ "default", "" },
+	{ "smpte", "smpte" },
+};
+
+struct Result {
+	PixelFormat format;
+	uint32_t width;
+	uint32_t height;
+	string pattern;
+	unsigned threads;
+	unsigned iterations;
+	size_t frame_bytes;
+	double median_ms;
+	double min_ms;
+};
+
+static Result run_benchmark(PixelFormat format, uint32_t width, uint32_t height,
+			    const string& pattern, unsigned threads, unsigned min_iterations,
+			    double min_time_ms)
+{
+	CPUFramebuffer fb(width, height, format);
+
+	TestPatternOptions options;
+	options.pattern = patterns.at(pattern);
+	options.num_threads = threads;
+
+	// Fault in the framebuffer and warm up the caches and the thread pool
+	draw_test_pattern_multi(fb, options);
+
+	vector<double> times;
+	double total_ms = 0;
+
+	while (times.size() < min_iterations || total_ms < min_time_ms) {
+		Stopwatch sw;
+		sw.start();
+
+		draw_test_pattern_multi(fb, options);
+
+		times.push_back(sw.elapsed_ms());
+		total_ms += times.back();
+	}
+
+	ranges::sort(times);
+
+	size_t frame_bytes = 0;
+	for (unsigned p = 0; p < fb.num_planes(); ++p)
+		frame_bytes += fb.size(p);
+
+	return {
+		format,
+		width,
+		height,
+		pattern,
+		threads,
+		(unsigned)times.size(),
+		frame_bytes,
+		times[times.size() / 2],
+		times.front(),
+	};
+}
+
+static string get_arch()
+{
+#if defined(__x86_64__)
+	return "x86_64";
+#elif defined(__i386__)
+	return "x86";
+#elif defined(__aarch64__)
+	return "aarch64";
+#elif defined(__arm__)
+	return "arm";
+#elif defined(__riscv)
+	return "riscv";
+#else
+	return "unknown";
+#endif
+}
+
+static string to_json(const vector<Result>& results, unsigned num_cpus)
+{
+	// The single threaded times, for the scaling efficiency
+	map<tuple<PixelFormat, uint32_t, uint32_t, string>, double> single_ms;
+
+	for (const Result& r : results) {
+		if (r.threads == 1)
+			single_ms[{ r.format, r.width, r.height, r.pattern }] = r.median_ms;
+	}
+
+	string json;
+
+	json += "{\n";
+	json += fmt::format("  \"arch\": \"{}\",\n", get_arch());
+	json += fmt::format("  \"compiler\": \"{}\",\n", __VERSION__);
+	json += fmt::format("  \"simd\": \"{}\",\n", get_simd_level());
+	json += fmt::format("  \"cpus\": {},\n", num_cpus);
+	json += "  \"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		const double pixels = (double)r.width * r.height;
+
+		json += fmt::format("    {{ \"format\": \"{}\", \"width\": {}, \"height\": {}, "
+				    "\"pattern\": \"{}\", \"threads\": {}, \"iterations\": {}, "
+				    "\"median_ms\": {:.3f}, \"min_ms\": {:.3f}, "
+				    "\"mb_per_s\": {:.1f}, \"ns_per_pixel\": {:.3f}",
+				    get_pixel_format_info(r.format).name, r.width, r.height,
+				    r.pattern, r.threads, r.iterations, r.median_ms, r.min_ms,
+				    r.frame_bytes / (r.median_ms * 1000.0),
+				    r.median_ms * 1000000.0 / pixels);
+
+		auto it = single_ms.find({ r.format, r.width, r.height, r.pattern });
+
+		if (r.threads > 1 && it != single_ms.end()) {
+			const double speedup = it->second / r.median_ms;
+
+			json += fmt::format(", \"speedup\": {:.3f}, \"scaling_efficiency\": {:.3f}",
+					    speedup, speedup / r.threads);
+		}
+
+		json += i + 1 < results.size() ? " },\n" : " }\n";
+	}
+
+	json += "  ]\n";
+	json += "}\n";
+
+	return json;
+}
+
+int main(int argc, char** argv)
+{
+	vector<PixelFormat> formats;
+	vector<tuple<uint32_t, uint32_t>> sizes;
+	vector<string> pattern_names;
+	vector<unsigned> thread_counts;
+	unsigned min_iterations = 3;
+	double min_time_ms = 100;
+	string output;
+	bool quiet = false;
+
+	OptionSet optionset = {
+		Option("f|format=", [&](string s) {
+			formats.push_back(find_pixel_format_by_name(s));
+		}),
+		Option("s|size=", [&](string s) {
+			uint32_t w, h;
+			if (sscanf(s.c_str(), "%ux%u", &w, &h) != 2)
+				EXIT("Bad size '%s'", s.c_str());
+			sizes.push_back({ w, h });
+		}),
+		Option("p|pattern=", [&](string s) {
+			if (!patterns.count(s))
+				EXIT("Bad pattern '%s'", s.c_str());
+			pattern_names.push_back(s);
+		}),
+		Option("t|threads=", [&](string s) {
+			thread_counts.push_back(stoul(s));
+		}),
+		Option("i|iterations=", [&](string s) {
+			min_iterations = max(stoul(s), 1ul);
+		}),
+		Option("m|min-time=", [&](string s) {
+			min_time_ms = stod(s);
+		}),
+		Option("o|output=", [&](string s) {
+			output = s;
+		}),
+		Option("q|quiet", [&]() {
+			quiet = true;
+		}),
+		Option("h|help", []() {
+			usage();
+			exit(-1);
+		}),
+	};
+
+	optionset.parse(argc, argv);
+
+	if (optionset.params().size() > 0) {
+		usage();
+		exit(-1);
+	}
+
+	const unsigned num_cpus = max(thread::hardware_concurrency(), 1u);
+
+	if (formats.empty()) {
+		for (size_t i = 1; i < num_pixel_formats; ++i) {
+			if (test_pattern_supports_format((PixelFormat)i))
+				formats.push_back((PixelFormat)i);
+		}
+	}
+
+	if (sizes.empty())
+		sizes = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+
+	if (pattern_names.empty())
+		pattern_names = { "solid", "default", "smpte" };
+
+	if (thread_counts.empty())
+		thread_counts = { 1, 0 };
+
+	for (unsigned& t : thread_counts) {
+		if (t == 0)
+			t = num_cpus;
+	}
+
+	ranges::sort(thread_counts);
+	thread_counts.erase(unique(thread_counts.begin(), thread_counts.end()),
+			    thread_counts.end());
+
+	vector<Result> results;
+
+	for (PixelFormat format : formats) {
+		const auto& info = get_pixel_format_info(format);
+
+		if (!test_pattern_supports_format(format))
+			EXIT("Format %s not supported", string(info.name).c_str());
+
+		for (auto [w, h] : sizes) {
+			tie(w, h) = info.align_pixels(w, h);
+
+			for (const string& pattern : pattern_names) {
+				for (unsigned threads : thread_counts) {
+					Result r = run_benchmark(format, w, h, pattern, threads,
+								 min_iterations, min_time_ms);
+
+					if (!quiet)
+						fmt::print(stderr, "{:12} {:5}x{:<5} {:8} {:3} threads: {:9.3f} ms\n",
+							   info.name, w, h, pattern, threads, r.median_ms);
+
+					results.push_back(r);
+				}
+			}
+		}
+	}
+
+	string json = to_json(results, num_cpus);
+
+	if (output.empty()) {
+		fputs(json.c_str(), stdout);
+	} else {
+		FILE* f = fopen(output.c_str(), "w");
+		if (!f)
+			EXIT("Failed to open '%s'", output.c_str());
+		fputs(json.c_str(), f);
+		fclose(f);
+	}
+
+	return 0;
+}
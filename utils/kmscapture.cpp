@@ -33,7 +33,8 @@ public:
 	CameraPipeline(const CameraPipeline& other) = delete;
 	CameraPipeline& operator=(const CameraPipeline& other) = delete;
 
-	void show_next_frame(AtomicReq& req);
+	void add_fb_slot(PreparedAtomicReq& req);
+	void show_next_frame(PreparedAtomicReq& req);
 	int fd() const { return m_fd; }
 	void start_streaming();
 
@@ -45,6 +46,7 @@ private:
 	BufferProvider m_buffer_provider;
 	vector<Framebuffer*> m_fb;
 	int m_prev_fb_index;
+	size_t m_fb_slot;
 	uint32_t m_in_width, m_in_height; /* camera capture resolution */
 	/* image properties for display */
 	uint32_t m_out_width, m_out_height;
@@ -100,7 +102,7 @@ bool inline better_size(struct v4l2_frmsize_discrete* v4ldisc,
 CameraPipeline::CameraPipeline(int cam_fd, Card& card, Crtc* crtc, Plane* plane, uint32_t x, uint32_t y,
 			       uint32_t iw, uint32_t ih, PixelFormat pixfmt,
 			       BufferProvider buffer_provider)
-	: m_fd(cam_fd), m_crtc(crtc), m_buffer_provider(buffer_provider), m_prev_fb_index(-1)
+	: m_fd(cam_fd), m_crtc(crtc), m_buffer_provider(buffer_provider), m_prev_fb_index(-1), m_fb_slot(0)
 {
 	int r;
 	uint32_t best_w = 320;
@@ -227,7 +229,13 @@ void CameraPipeline::start_streaming()
 	FAIL_IF(r, "Failed to enable camera stream: %d", r);
 }
 
-void CameraPipeline::show_next_frame(AtomicReq& req)
+void CameraPipeline::add_fb_slot(PreparedAtomicReq& req)
+{
+	// The first fb is shown by the initial plane setup
+	m_fb_slot = req.add(m_plane, "FB_ID", m_fb[0]->id());
+}
+
+void CameraPipeline::show_next_frame(PreparedAtomicReq& req)
 {
 	int r;
 	uint32_t v4l_mem;
@@ -250,7 +258,8 @@ void CameraPipeline::show_next_frame(AtomicReq& req)
 
 	Framebuffer* fb = m_fb[fb_index];
 
-	req.add(m_plane, "FB_ID", fb->id());
+	req.set(m_fb_slot, fb->id());
+	req.set_active(m_fb_slot, true);
 
 	if (m_prev_fb_index >= 0) {
 		memset(&v4l2buf, 0, sizeof(v4l2buf));
@@ -389,6 +398,13 @@ int main(int argc, char** argv)
 	fds[nr_cameras].fd = 0;
 	fds[nr_cameras].events = POLLIN;
 
+	// A request with the fb slots of all the cameras. Only the slots of the
+	// cameras with a new frame are active in a commit.
+	PreparedAtomicReq req(card);
+
+	for (auto cam : cameras)
+		cam->add_fb_slot(req);
+
 	for (auto cam : cameras)
 		cam->start_streaming();
 
@@ -399,7 +415,8 @@ int main(int argc, char** argv)
 		if (fds[nr_cameras].revents != 0)
 			break;
 
-		AtomicReq req(card);
+		for (size_t slot = 0; slot < req.num_slots(); slot++)
+			req.set_active(slot, false);
 
 		for (unsigned i = 0; i < nr_cameras; i++) {
 			if (!fds[i].revents)
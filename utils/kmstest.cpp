@@ -71,6 +71,8 @@ static bool s_cvt_vid_opt;
 static unsigned s_max_flips;
 static bool s_print_crc;
 static TestPatternOptions s_pattern_options;
+static bool s_use_pattern_cache;
+static TestPatternCache s_pattern_cache;
 
 __attribute__((unused)) static void print_regex_match(smatch sm)
 {
@@ -418,6 +420,7 @@ static const char* usage_str =
 	"  -T, --pattern=PAT         test, white, black, red, green, blue, smpte\n"
 	"      --rec=REC             bt601, bt709, bt2020\n"
 	"      --range=RANGE         limited, full\n"
+	"      --cache               Draw the test patterns of the same size and format only once\n"
 	"\n"
 	"<connector>, <crtc> and <plane> can be given by index (<idx>) or id (@<id>).\n"
 	"<connector> can also be given by name.\n"
@@ -554,6 +557,9 @@ static vector<Arg> parse_cmdline(int argc, char** argv)
 				exit(-1);
 			}
 		}),
+		Option("|cache", []() {
+			s_use_pattern_cache = true;
+		}),
 		Option("h|help", [&]() {
 			usage();
 			exit(-1);
@@ -970,12 +976,56 @@ static void set_crtcs_n_planes(Card& card, const vector<OutputInfo>& outputs)
 
 static bool max_flips_reached;
 
+/*
+ * The damage of a set of flipped buffers relative to the buffer on the screen,
+ * i.e. the union of the damage drawn to the buffers during the last
+ * s_num_buffers frames
+ */
+class FlipDamage
+{
+public:
+	FlipDamage(const vector<Framebuffer*>& fbs)
+	{
+		for (Framebuffer* fb : fbs)
+			m_trackers.push_back(make_unique<DamageTracker>(*fb));
+
+		// The buffers' initial contents differ from the screen
+		DamageRegion full;
+		full.add({ 0, 0, fbs[0]->width(), fbs[0]->height() });
+		m_history.assign(fbs.size(), full);
+	}
+
+	// Take the damage drawn to the current buffer, and return the damage to show it
+	DamageRegion take(unsigned frame_num)
+	{
+		unsigned cur = frame_num % m_trackers.size();
+
+		m_history[cur] = m_trackers[cur]->take();
+
+		DamageRegion region;
+		for (const DamageRegion& r : m_history)
+			region.add(r);
+		return region;
+	}
+
+private:
+	vector<unique_ptr<DamageTracker>> m_trackers;
+	vector<DamageRegion> m_history;
+};
+
 class FlipState : private PageFlipHandlerBase
 {
 public:
 	FlipState(Card& card, const string& name, const vector<const OutputInfo*>& outputs)
 		: m_card(card), m_name(name), m_outputs(outputs), m_frame_num(0), m_flip_count(0)
 	{
+		for (const OutputInfo* o : m_outputs) {
+			if (!o->legacy_fbs.empty())
+				m_damage.try_emplace(&o->legacy_fbs, o->legacy_fbs);
+
+			for (const PlaneInfo& p : o->planes)
+				m_damage.try_emplace(&p.fbs, p.fbs);
+		}
 	}
 
 	void start_flipping()
@@ -1035,7 +1085,7 @@ private:
 		draw_text(*fb, fb->width() / 2, 0, to_string(frame_num), RGB(255, 255, 255));
 	}
 
-	static void do_flip_output(AtomicReq& req, unsigned frame_num, const OutputInfo& o)
+	void do_flip_output(AtomicReq& req, unsigned frame_num, const OutputInfo& o)
 	{
 		unsigned cur = frame_num % s_num_buffers;
 
@@ -1047,6 +1097,8 @@ private:
 			req.add(p.plane, {
 						 { "FB_ID", fb->id() },
 					 });
+
+			add_damage_clips(req, p.plane, m_damage.at(&p.fbs).take(frame_num));
 		}
 	}
 
@@ -1058,6 +1110,7 @@ private:
 			auto fb = o.legacy_fbs[cur];
 
 			draw_bar(fb, frame_num);
+			flush_damage(*fb, m_damage.at(&o.legacy_fbs).take(frame_num));
 
 			int r = o.crtc->page_flip(*fb, this);
 			ASSERT(r == 0);
@@ -1067,6 +1120,7 @@ private:
 			auto fb = p.fbs[cur];
 
 			draw_bar(fb, frame_num);
+			flush_damage(*fb, m_damage.at(&p.fbs).take(frame_num));
 
 			int r = o.crtc->set_plane(p.plane, *fb,
 						  p.x, p.y, p.w, p.h,
@@ -1099,6 +1153,7 @@ private:
 	vector<const OutputInfo*> m_outputs;
 	unsigned m_frame_num;
 	unsigned m_flip_count;
+	map<const vector<Framebuffer*>*, FlipDamage> m_damage;
 
 	chrono::steady_clock::time_point m_prev_print;
 	chrono::steady_clock::time_point m_prev_frame;
@@ -1165,6 +1220,10 @@ int main(int argc, char** argv)
 {
 	vector<Arg> output_args = parse_cmdline(argc, argv);
 
+	// Buffers of the same size and format are drawn only once
+	if (s_use_pattern_cache)
+		s_pattern_options.cache = &s_pattern_cache;
+
 	Card card(s_device_path);
 
 	if (!card.is_master())
@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <fstream>
+#include <memory>
 #include <unistd.h>
 #include <cassert>
 
@@ -9,10 +10,15 @@
 using namespace std;
 using namespace kms;
 
-static void read_frame(ifstream& is, DumbFramebuffer* fb, Crtc* crtc, Plane* plane)
+// If file_fb is not the fb, the frame is read to file_fb and converted to the fb
+static void read_frame(ifstream& is, IFramebuffer* file_fb, DumbFramebuffer* fb, Crtc* crtc,
+		       Plane* plane)
 {
-	for (unsigned i = 0; i < fb->num_planes(); ++i)
-		is.read(reinterpret_cast<char*>(fb->map(i)), fb->size(i));
+	for (unsigned i = 0; i < file_fb->num_planes(); ++i)
+		is.read(reinterpret_cast<char*>(file_fb->map(i)), file_fb->size(i));
+
+	if (file_fb != fb)
+		convert_framebuffer(*file_fb, *fb);
 
 	unsigned w = min(crtc->width(), fb->width());
 	unsigned h = min(crtc->height(), fb->height());
@@ -85,13 +91,31 @@ int main(int argc, char** argv)
 	auto conn = res.reserve_connector(conn_name);
 	auto crtc = res.reserve_crtc(conn);
 	auto plane = res.reserve_overlay_plane(crtc, pixfmt);
+	auto plane_fmt = pixfmt;
+
+	// Convert the frames if no plane supports the format
+	if (!plane) {
+		plane_fmt = PixelFormat::XRGB8888;
+		plane = res.reserve_overlay_plane(crtc, plane_fmt);
+	}
+
 	FAIL_IF(!plane, "available plane not found");
 
-	auto fb = new DumbFramebuffer(card, w, h, pixfmt);
+	auto fb = new DumbFramebuffer(card, w, h, plane_fmt);
+
+	unique_ptr<CPUFramebuffer> src_fb;
+	IFramebuffer* file_fb = fb;
+
+	if (plane_fmt != pixfmt) {
+		printf("converting from %s to %s\n", pixel_format_to_fourcc_str(pixfmt).c_str(),
+		       pixel_format_to_fourcc_str(plane_fmt).c_str());
+		src_fb = make_unique<CPUFramebuffer>(w, h, pixfmt);
+		file_fb = src_fb.get();
+	}
 
 	unsigned frame_size = 0;
-	for (unsigned i = 0; i < fb->num_planes(); ++i)
-		frame_size += fb->size(i);
+	for (unsigned i = 0; i < file_fb->num_planes(); ++i)
+		frame_size += file_fb->size(i);
 
 	assert(frame_size);
 
@@ -101,7 +125,7 @@ int main(int argc, char** argv)
 	for (unsigned i = 0; i < num_frames; ++i) {
 		printf("frame %u", i);
 		fflush(stdout);
-		read_frame(is, fb, crtc, plane);
+		read_frame(is, file_fb, fb, crtc, plane);
 		if (!time) {
 			getchar();
 		} else {